@@ -4,11 +4,17 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <ctime>
 #include <functional>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -25,160 +31,238 @@ namespace baseline {
 
 // ---------------策略----------------
 
-inline std::vector<std::array<bool, 2>> should_jmp;  // 每一个 slice 读取完毕后应该强制跳转
+inline std::vector<std::array<bool, 2>> should_jmp;        // 每一个 slice 读取完毕后应该强制跳转
+inline std::vector<std::array<bool, 2>> idle_positioned;  // 硬盘空闲时磁头已经被提前移动到预计会有请求的 slice
 
 inline std::vector<std::vector<int>> suffix_sum_read;  // tag 在每个时间片的后续读取次数
 inline std::vector<std::vector<double>> similarity;    // tag 两两之间的相似度
 
 inline int tot_group = 0;                                                 // 当前的 group 数量
 inline std::vector<std::array<std::pair<int, int>, 3>> group_disk_slice;  // group_id -> (disk_id, slice_id)x3
+// 第一个 slice 中可能有这个 tag 的 group，写入时加入，查询时删除已经没有这个 tag 的 group
+inline std::vector<std::set<int>> tag_groups;
+
+// 读取热度：每个时间窗口中 tag 的每个块被读取的次数，热的对象放在 slice 的前面，扫描可以更早结束
+inline std::vector<std::vector<double>> tag_read_heat;
+inline std::vector<double> mean_read_heat;  // 每个时间窗口所有 tag 的平均热度
 
 // 本地初始化
-std::vector<std::vector<int>> generate_all_triples(int num_disks) {
-    std::vector<std::vector<int>> triples;
-    for (int i = 0; i < num_disks - 2; i++) {
-        for (int j = i + 1; j < num_disks - 1; j++) {
-            for (int k = j + 1; k < num_disks; k++) {
-                triples.push_back({i, j, k});
+// 硬盘三元组的设计：每个硬盘最多出现 max_appearance 次，任意两个硬盘出现在同一个三元组中的次数尽量相同
+// 加入一个三元组之后，所有硬盘对出现次数的均值不变，方差的变化只取决于这个三元组的三对硬盘已经出现的次数之和
+class TripleDesign {
+   public:
+    TripleDesign(int num_disks, int max_appearance)
+        : num_disks(num_disks),
+          max_appearance(max_appearance),
+          pair_count_(num_disks * num_disks),
+          disk_count_(num_disks) {}
+
+    bool has_room(int disk) const { return disk_count_[disk] < max_appearance; }
+    int disk_count(int disk) const { return disk_count_[disk]; }
+    int pair_count(int x, int y) const { return pair_count_[x * num_disks + y]; }
+    int pair_sum(int x, int y, int z) const { return pair_count(x, y) + pair_count(x, z) + pair_count(y, z); }
+    bool is_used(int x, int y, int z) const { return used_.count(encode(x, y, z)) != 0; }
+
+    void add(int x, int y, int z) {
+        std::array<int, 3> triple{x, y, z};
+        std::sort(triple.begin(), triple.end());
+        groups.push_back({triple[0], triple[1], triple[2]});
+        used_.insert(encode(x, y, z));
+        for (int a = 0; a < 3; a++) {
+            disk_count_[triple[a]]++;
+            for (int b = a + 1; b < 3; b++) {
+                pair_count_[triple[a] * num_disks + triple[b]]++;
+                pair_count_[triple[b] * num_disks + triple[a]]++;
             }
         }
     }
-    return triples;
-}
 
-double compute_variance(const std::map<std::pair<int, int>, int>& pair_counts) {
-    if (pair_counts.empty()) return 0.0;
-    double mean = 0.0;
-    for (const auto& entry : pair_counts) {
-        mean += entry.second;
+    // 把第 index 个三元组中的 old_disk 换成 new_disk
+    void replace(int index, int old_disk, int new_disk) {
+        auto& group = groups[index];
+        used_.erase(encode(group[0], group[1], group[2]));
+        for (int other : group) {
+            if (other == old_disk) continue;
+            pair_count_[old_disk * num_disks + other]--;
+            pair_count_[other * num_disks + old_disk]--;
+            pair_count_[new_disk * num_disks + other]++;
+            pair_count_[other * num_disks + new_disk]++;
+        }
+        disk_count_[old_disk]--;
+        disk_count_[new_disk]++;
+        *std::find(group.begin(), group.end(), old_disk) = new_disk;
+        std::sort(group.begin(), group.end());
+        used_.insert(encode(group[0], group[1], group[2]));
     }
-    mean /= pair_counts.size();
 
-    double variance = 0.0;
-    for (const auto& entry : pair_counts) {
-        variance += pow(entry.second - mean, 2);
-    }
-    return variance / pair_counts.size();
-}
+    const int num_disks;
+    const int max_appearance;
+    std::vector<std::vector<int>> groups;
 
-std::vector<std::vector<int>> select_balanced_groups(int num_disks, int max_appearance, int target_groups) {
-    std::vector<std::vector<int>> all_triples = generate_all_triples(num_disks);
-    std::vector<std::vector<int>> selected_groups;
-    std::map<std::pair<int, int>, int> pair_counts;
-    std::map<int, int> disk_counts;
+   private:
+    long long encode(int x, int y, int z) const {
+        std::array<int, 3> triple{x, y, z};
+        std::sort(triple.begin(), triple.end());
+        return ((long long)triple[0] * num_disks + triple[1]) * num_disks + triple[2];
+    }
 
-    // 初始化所有可能的数字对
-    for (int i = 0; i < num_disks; ++i) {
-        for (int j = i + 1; j < num_disks; ++j) {
-            pair_counts[{i, j}] = 0;
+    std::vector<int> pair_count_;  // [x * num_disks + y]
+    std::vector<int> disk_count_;
+    HashSet<long long> used_;
+};
+
+constexpr long long EXHAUSTIVE_TRIPLE_LIMIT = 20000000;  // 枚举所有三元组贪心的计算量上限
+
+// 每次在所有没有用过的三元组中选择硬盘对出现次数之和最小的
+// 相同时选择硬盘出现次数之和最小的，硬盘的剩余次数保持均衡，最后不会只剩下凑不成三元组的硬盘
+inline void exhaustive_greedy(TripleDesign& design, int target_groups) {
+    int n = design.num_disks;
+    std::vector<std::array<int, 3>> triples;
+    for (int i = 0; i < n - 2; i++) {
+        for (int j = i + 1; j < n - 1; j++) {
+            for (int k = j + 1; k < n; k++) {
+                triples.push_back({i, j, k});
+            }
         }
     }
-
-    while (selected_groups.size() < target_groups) {
-        double min_variance = std::numeric_limits<double>::max();
-        std::vector<int> best_group;
+    std::vector<char> taken(triples.size());
+    while ((int)design.groups.size() < target_groups) {
         int best_index = -1;
+        std::pair<int, int> best_cost;
+        for (int i = 0; i < (int)triples.size(); i++) {
+            const auto& [x, y, z] = triples[i];
+            if (taken[i] || !design.has_room(x) || !design.has_room(y) || !design.has_room(z)) continue;
+            std::pair<int, int> cost{design.pair_sum(x, y, z),
+                                     design.disk_count(x) + design.disk_count(y) + design.disk_count(z)};
+            if (best_index == -1 || cost < best_cost) {
+                best_cost = cost;
+                best_index = i;
+            }
+        }
+        if (best_index == -1) {
+            break;
+        }
+        taken[best_index] = 1;
+        design.add(triples[best_index][0], triples[best_index][1], triples[best_index][2]);
+    }
+}
 
-        for (size_t i = 0; i < all_triples.size(); ++i) {
-            const std::vector<int>& group = all_triples[i];
-            bool valid = true;
-            for (int disk : group) {
-                if (disk_counts[disk] >= max_appearance) {
-                    valid = false;
+// 循环差族：基块 {0, a, a + b} 在 Z_n 上平移得到 n 个三元组，每个硬盘出现 3 次
+// 不同基块的差 a、b、a + b 互不相同时，每对硬盘最多被覆盖一次，差相同的硬盘对被覆盖的次数完全相同
+inline void cyclic_design(TripleDesign& design, int target_groups) {
+    int n = design.num_disks;
+    int half = (n - 1) / 2;  // n 为偶数时差 n / 2 只对应 n / 2 对硬盘，不使用
+    auto norm = [&](int d) { return std::min(d % n, n - d % n); };
+    std::vector<char> used_diff(half + 1);
+    while ((int)design.groups.size() + n <= target_groups && design.disk_count(0) + 3 <= design.max_appearance) {
+        int base_a = 0, base_b = 0;
+        for (int a = 1; a <= half && base_a == 0; a++) {
+            for (int b = a + 1; b <= half; b++) {
+                int c = norm(a + b);
+                if (!used_diff[a] && !used_diff[b] && c != 0 && c <= half && c != a && c != b && !used_diff[c]) {
+                    base_a = a, base_b = b;
                     break;
                 }
             }
-            if (!valid) continue;
-
-            std::map<std::pair<int, int>, int> temp_pair_counts = pair_counts;
-            std::map<int, int> temp_disk_counts = disk_counts;
+        }
+        if (base_a == 0) {
+            break;
+        }
+        used_diff[base_a] = used_diff[base_b] = used_diff[norm(base_a + base_b)] = 1;
+        for (int i = 0; i < n; i++) {
+            design.add(i, (i + base_a) % n, (i + base_a + base_b) % n);
+        }
+    }
+}
 
-            for (int a = 0; a < 2; ++a) {
-                for (int b = a + 1; b < 3; ++b) {
-                    int x = group[a], y = group[b];
-                    if (x > y) std::swap(x, y);
-                    temp_pair_counts[{x, y}]++;
+// 补齐剩下的三元组：出现次数最少的硬盘，加上和它、和它们一起出现次数最少的两个硬盘，每个三元组 O(n)
+inline void balanced_greedy(TripleDesign& design, int target_groups) {
+    int n = design.num_disks;
+    while ((int)design.groups.size() < target_groups) {
+        int x = -1;
+        for (int i = 0; i < n; i++) {
+            if (design.has_room(i) && (x == -1 || design.disk_count(i) < design.disk_count(x))) x = i;
+        }
+        auto pick = [&](auto cost, auto valid) {
+            int best = -1;
+            std::pair<int, int> best_cost;
+            for (int i = 0; i < n; i++) {
+                if (!design.has_room(i) || !valid(i)) continue;
+                std::pair<int, int> c{cost(i), design.disk_count(i)};
+                if (best == -1 || c < best_cost) {
+                    best = i;
+                    best_cost = c;
                 }
             }
-            for (int disk : group) {
-                temp_disk_counts[disk]++;
-            }
-
-            double current_variance = compute_variance(temp_pair_counts);
-            if (current_variance < min_variance) {
-                min_variance = current_variance;
-                best_group = group;
-                best_index = i;
-            }
+            return best;
+        };
+        int y = x == -1 ? -1 : pick([&](int i) { return design.pair_count(x, i); }, [&](int i) { return i != x; });
+        int z = y == -1 ? -1
+                        : pick([&](int i) { return design.pair_count(x, i) + design.pair_count(y, i); },
+                               [&](int i) { return i != x && i != y && !design.is_used(x, y, i); });
+        if (z == -1) {
+            break;
         }
+        design.add(x, y, z);
+    }
+}
 
-        if (best_index != -1) {
-            selected_groups.push_back(best_group);
-            for (int a = 0; a < 2; ++a) {
-                for (int b = a + 1; b < 3; ++b) {
-                    int x = best_group[a], y = best_group[b];
-                    if (x > y) std::swap(x, y);
-                    pair_counts[{x, y}]++;
-                }
-            }
-            for (int disk : best_group) {
-                disk_counts[disk]++;
-            }
-            all_triples.erase(all_triples.begin() + best_index);
-        } else {
-            // 如果没有找到合适的组合，强制选择一个
-            if (all_triples.empty()) {
-                std::cerr << "Warning: all_triples is empty, breaking loop." << std::endl;
-                break;  // 添加此行
-            }
-            bool found_valid = false;
-            for (size_t i = 0; i < all_triples.size(); ++i) {
-                const std::vector<int>& group = all_triples[i];
-                bool valid = true;
-                for (int disk : group) {
-                    if (disk_counts[disk] >= max_appearance) {
-                        valid = false;
-                        break;
-                    }
-                }
-                if (valid) {
-                    found_valid = true;
-                    break;
-                }
-            }
-            if (!found_valid) {
-                std::cerr << "Warning: No valid triples left, breaking loop." << std::endl;
-                break;
-            }
-            for (size_t i = 0; i < all_triples.size(); ++i) {
-                const std::vector<int>& group = all_triples[i];
-                bool valid = true;
-                for (int disk : group) {
-                    if (disk_counts[disk] >= max_appearance) {
-                        valid = false;
-                        break;
-                    }
+// 贪心到最后剩下的硬盘可能凑不成三元组（不足三个硬盘，或者它们的三元组已经用过）
+// 剩余次数最多的硬盘 a 替换某个不含 a 的三元组中没有剩余次数的硬盘 x，x 空出一次，直到有三个硬盘有剩余次数
+// 补上的三元组允许和之前的重复
+inline void repair_groups(TripleDesign& design, int target_groups) {
+    int n = design.num_disks;
+    while ((int)design.groups.size() < target_groups) {
+        std::vector<int> room;
+        for (int i = 0; i < n; i++) {
+            if (design.has_room(i)) room.push_back(i);
+        }
+        std::stable_sort(room.begin(), room.end(),
+                         [&](int i, int j) { return design.disk_count(i) < design.disk_count(j); });
+        if (room.size() >= 3) {
+            design.add(room[0], room[1], room[2]);
+            continue;
+        }
+        if (room.empty()) break;
+        int a = room[0];
+        int best_index = -1, best_disk = -1, best_cost = std::numeric_limits<int>::max();
+        for (int index = 0; index < (int)design.groups.size(); index++) {
+            const auto& group = design.groups[index];
+            if (std::find(group.begin(), group.end(), a) != group.end()) continue;
+            for (int x : group) {
+                if (design.has_room(x)) continue;
+                int cost = 0;
+                for (int other : group) {
+                    if (other != x) cost += design.pair_count(a, other);
                 }
-                if (valid) {
-                    selected_groups.push_back(group);
-                    for (int a = 0; a < 2; ++a) {
-                        for (int b = a + 1; b < 3; ++b) {
-                            int x = group[a], y = group[b];
-                            if (x > y) std::swap(x, y);
-                            pair_counts[{x, y}]++;
-                        }
-                    }
-                    for (int disk : group) {
-                        disk_counts[disk]++;
-                    }
-                    all_triples.erase(all_triples.begin() + i);
-                    break;
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_index = index;
+                    best_disk = x;
                 }
             }
         }
+        if (best_index == -1) break;
+        design.replace(best_index, best_disk, a);
     }
+}
 
-    return selected_groups;
+// 硬盘少的时候直接枚举所有三元组，否则先用循环差族覆盖大部分，剩下的贪心补齐
+inline std::vector<std::vector<int>> select_balanced_groups(int num_disks, int max_appearance, int target_groups) {
+    TripleDesign design(num_disks, max_appearance);
+    long long triple_num = 1LL * num_disks * (num_disks - 1) * (num_disks - 2) / 6;
+    if (triple_num * target_groups <= EXHAUSTIVE_TRIPLE_LIMIT) {
+        exhaustive_greedy(design, target_groups);
+    } else {
+        cyclic_design(design, target_groups);
+        balanced_greedy(design, target_groups);
+    }
+    repair_groups(design, target_groups);
+    if ((int)design.groups.size() < target_groups) {
+        std::cerr << "Warning: No valid triples left, " << design.groups.size() << " / " << target_groups
+                  << " groups." << std::endl;
+    }
+    return design.groups;
 }
 
 std::vector<std::array<std::pair<int, int>, 3>> chosen_disk_slice(int num_disks, int max_appearance,
@@ -266,6 +350,17 @@ inline void init_local() {
         chosen_disk_slice(global::N, global::disks[0].slice_num, global::N * global::disks[0].slice_num / 3);
     tot_group = group_disk_slice.size();
     std::shuffle(group_disk_slice.begin(), group_disk_slice.end(), global::rng);
+    tag_groups.resize(global::M + 1);
+    tag_read_heat.assign(global::M + 1, std::vector<double>(global::fre_len + 1));
+    mean_read_heat.assign(global::fre_len + 1, 0);
+    for (int i = 1; i <= global::M; i++) {
+        long long live = 0;
+        for (int j = 1; j <= global::fre_len; j++) {
+            live += global::fre_write[i][j] - global::fre_del[i][j];
+            tag_read_heat[i][j] = 1.0 * global::fre_read[i][j] / std::max(live, 1LL);
+            mean_read_heat[j] += tag_read_heat[i][j] / global::M;
+        }
+    }
     //  最后一个 slice 的长度和前面不一样，需要单独处理
     /*temp_disk_slice.clear();
     for (int i = 1; i <= global::N; i++) {
@@ -279,6 +374,7 @@ inline void init_local() {
     }*/
 
     should_jmp.resize(global::N + 1);
+    idle_positioned.resize(global::N + 1);
 
     suffix_sum_read = global::fre_read;
     for (int i = 1; i <= global::M; i++) {
@@ -358,7 +454,7 @@ inline std::vector<int> put_forward(int disk_id, int slice_id, int size) {
     }
     return block_id;
 }
-std::vector<int> put_back(int disk_id, int slice_id, int size) {
+inline std::vector<int> put_back(int disk_id, int slice_id, int size) {
     std::vector<int> block_id(size + 1);
     const Disk& disk = global::disks[disk_id];
     // 选择策略：选择最短的能放下size个块的空间
@@ -368,19 +464,19 @@ std::vector<int> put_back(int disk_id, int slice_id, int size) {
     int count = 0;
     int min_len_p = -1, min_len = 2e9;
 
-    while (lst > fir - 1 && count < size) {  // 修改：从大端开始
+    while (lst > fir && count < size) {  // 修改：从大端开始
         lst--;
         if (disk.blocks[lst].object_id == 0) count++;
     }
 
     for (int i = end_pos;; i--) {  // 修改：从大端开始
-        if (lst == fir - 1 && count < size) break;
+        if (lst == fir && count < size) break;
         if (i - lst < min_len) {  // 修改：计算长度
             min_len = i - lst;
             min_len_p = i;
         }
         if (disk.blocks[i].object_id == 0) count--;
-        while (lst > fir - 1 && count < size) {  // 修改：从大端开始
+        while (lst > fir && count < size) {  // 修改：从大端开始
             lst--;
             if (disk.blocks[lst].object_id == 0) count++;
         }
@@ -401,6 +497,190 @@ std::vector<int> put_back(int disk_id, int slice_id, int size) {
     return block_id;
 }
 
+// 按照某些优先级给 group 排序，越小越优先
+struct GroupValue {
+    bool has_tag;
+    bool is_empty;
+    int tag_num;
+    int empty_block_num;
+    bool is_dominant;  // 是否是 tag 主导的 slice
+    // 所在的 disk 的相关信息
+    int empty_slice_num;
+    int tag_slice_num;
+
+    bool operator<(const GroupValue& other) const {
+        // 优先拥有 tag
+        if (has_tag != other.has_tag) {
+            return has_tag > other.has_tag;
+        }
+        if (has_tag) {
+            // 优先纯色的 slice
+            if (tag_num != other.tag_num) {
+                return tag_num < other.tag_num;
+            }
+            if (is_dominant) {
+                // 优先空闲块数少的 slice（优先放满）
+                if (empty_block_num != other.empty_block_num) {
+                    return empty_block_num < other.empty_block_num;
+                }
+            } else {
+                // 优先 tag 数量少的 slice
+                if (tag_num != other.tag_num) {
+                    return tag_num < other.tag_num;
+                }
+                // 优先空闲块数多的 slice
+                if (empty_block_num != other.empty_block_num) {
+                    return empty_block_num > other.empty_block_num;
+                }
+                // 优先相同的 tag 较少的 disk（负载均衡）
+                if (tag_slice_num != other.tag_slice_num) {
+                    return tag_slice_num < other.tag_slice_num;
+                }
+            }
+        } else {
+            // 优先空闲的 slice
+            if (is_empty != other.is_empty) {
+                return is_empty > other.is_empty;
+            }
+            if (is_empty) {
+                // 优先相同的 tag 较少的 disk（负载均衡）
+                if (tag_slice_num != other.tag_slice_num) {
+                    return tag_slice_num < other.tag_slice_num;
+                }
+                // 优先空闲 slice 数多的 disk
+                if (empty_slice_num != other.empty_slice_num) {
+                    return empty_slice_num > other.empty_slice_num;
+                }
+            } else {
+                // 优先 tag 数量少的 slice
+                if (tag_num != other.tag_num) {
+                    return tag_num < other.tag_num;
+                }
+                // 优先空闲块数多的 slice
+                if (empty_block_num != other.empty_block_num) {
+                    return empty_block_num > other.empty_block_num;
+                }
+                // 优先相同的 tag 较少的 disk（负载均衡）
+                if (tag_slice_num != other.tag_slice_num) {
+                    return tag_slice_num < other.tag_slice_num;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+inline long long group_key_count;  // 计算 group_key 的次数，用来限制批量放置的计算量
+
+inline GroupValue group_key(int group_id, int tag) {
+    group_key_count++;
+    int disk_id = group_disk_slice[group_id][0].first;
+    int slice_id = group_disk_slice[group_id][0].second;
+    Disk& disk = global::disks[disk_id];
+    // 计算 slice 的信息
+    bool has_tag = (disk.slice_tag[slice_id] & (1 << tag)) == (1 << tag);
+    int tag_num = __builtin_popcount(disk.slice_tag[slice_id]);
+    int empty_block_num = disk.slice_empty_block_num[slice_id];
+    bool is_empty = (empty_block_num == disk.slice_end[slice_id] - disk.slice_start[slice_id] + 1);
+
+    // 由于三三分组，这里选择三个 slice 所在 disk 中拥有最少 slice 数的硬盘作为参考
+    int min_empty_slice_num = global::disks[disk_id].slice_num;
+    // 由于三三分组，这里选择三个 slice 所在 disk 中拥有最多相同 tag 的 slice 数的硬盘作为参考
+    int max_tag_slice_num = 0;
+    for (int i = 0; i < 3; i++) {
+        const Disk& disk = global::disks[group_disk_slice[group_id][i].first];
+        min_empty_slice_num = std::min(min_empty_slice_num, disk.empty_slice_num);
+        max_tag_slice_num = std::max(max_tag_slice_num, disk.tag_slice_num[tag]);
+    }
+
+    // 没有其它 tag 的块数比这个 tag 多
+    bool is_dominant = disk.slice_tag_writed_num[slice_id][tag] == disk.slice_max_tag_writed_num[slice_id];
+
+    return GroupValue{has_tag, is_empty, tag_num, empty_block_num, is_dominant, min_empty_slice_num, max_tag_slice_num};
+}
+
+// 能放下 size 个块的最优 group，不存在时返回 -1
+inline int best_group(int tag, int size) {
+    auto can_place = [&](int group_id) {
+        const auto& [disk_id, slice_id] = group_disk_slice[group_id][0];
+        return global::disks[disk_id].slice_empty_block_num[slice_id] >= size;
+    };
+    auto better = [&](int group_id1, int group_id2) { return group_key(group_id1, tag) < group_key(group_id2, tag); };
+    // 拥有 tag 的 group 总是优先，只有它们都放不下时才需要考虑所有的 group
+    int group_id = -1;
+    auto& candidate_groups = tag_groups[tag];
+    for (auto it = candidate_groups.begin(); it != candidate_groups.end();) {
+        const auto& [disk_id, slice_id] = group_disk_slice[*it][0];
+        if (!(global::disks[disk_id].slice_tag[slice_id] & (1 << tag))) {
+            it = candidate_groups.erase(it);
+            continue;
+        }
+        if (can_place(*it) && (group_id == -1 || better(*it, group_id))) {
+            group_id = *it;
+        }
+        it++;
+    }
+    if (group_id == -1) {
+        for (int i = 0; i < tot_group; i++) {
+            if (can_place(i) && (group_id == -1 || better(i, group_id))) {
+                group_id = i;
+            }
+        }
+    }
+    return group_id;
+}
+
+// 把对象写入 group，每个副本放进 slice 中最短的空闲区间，热的对象从前往后找，冷的对象从后往前找
+inline void place_object(ObjectWriteStrategy& strategy, int group_id) {
+    int time_block = std::min((global::timestamp - 1) / 1800 + 1, global::fre_len);
+    bool is_hot = tag_read_heat[strategy.object.tag][time_block] >= mean_read_heat[time_block];
+    for (int i = 0; i < 3; i++) {
+        int disk_id = group_disk_slice[group_id][i].first;
+        int slice_id = group_disk_slice[group_id][i].second;
+        strategy.disk_id[i] = disk_id;
+        strategy.slice_id[i] = slice_id;
+        strategy.block_id[i] = is_hot ? put_forward(disk_id, slice_id, strategy.object.size)
+                                      : put_back(disk_id, slice_id, strategy.object.size);
+        // 三个副本的块顺序各自轮转 1/3，从各个副本的开头读起来覆盖对象的不同部分
+        auto& block_id = strategy.block_id[i];
+        std::rotate(block_id.begin() + 1, block_id.begin() + 1 + i * strategy.object.size / 3, block_id.end());
+    }
+    tag_groups[strategy.object.tag].insert(group_id);
+    write_object(strategy);
+}
+
+// 单独放置一个对象
+inline void place_greedy(ObjectWriteStrategy& strategy) {
+    int group_id = best_group(strategy.object.tag, strategy.object.size);
+    if (group_id == -1) {
+        // 应该不会出现这种情况
+        throw std::runtime_error("No disk can be used.");
+    }
+    place_object(strategy, group_id);
+}
+
+// 一个时间片中同一个 tag 的多个对象作为一批放进同一个 group：按照总大小选择 group，避免同一批对象分散到不同的 slice
+// 批内的对象依次放进最短的空闲区间，前一个对象写入后后一个对象通常紧接着放置
+// 放不下时返回 false，由调用者逐个放置
+inline bool place_batch(std::vector<ObjectWriteStrategy*>& batch) {
+    int tag = batch[0]->object.tag, total_size = 0;
+    for (auto strategy : batch) {
+        total_size += strategy->object.size;
+    }
+    int group_id = best_group(tag, total_size);
+    if (group_id == -1) {
+        return false;
+    }
+    for (auto strategy : batch) {
+        place_object(*strategy, group_id);
+    }
+    return true;
+}
+
+// 每个时间片批量放置时计算 group_key 的次数上限，本地数据每个时间片最多约 300 次
+// 用次数而不是时间限制，放置的结果和机器的速度无关
+constexpr long long BATCH_PLACEMENT_BUDGET = 20000;
+
 // 写入策略函数，需要维护 object 和 disk 的状态
 inline std::vector<ObjectWriteStrategy> write_strategy_function(const std::vector<ObjectWriteRequest>& objects) {
     std::vector<ObjectWriteStrategy> strategies(objects.size());
@@ -421,304 +701,690 @@ inline std::vector<ObjectWriteStrategy> write_strategy_function(const std::vecto
         return object_key(i) < object_key(j);
     });
 
-    for (size_t opt = 0; opt < object_index.size(); opt++) {
-        const ObjectWriteRequest& object = objects[object_index[opt]];
-        ObjectWriteStrategy& strategy = strategies[object_index[opt]];
+    // 按照 tag 分批，批内保持上面的顺序
+    std::vector<std::vector<ObjectWriteStrategy*>> tag_batch(global::M + 1);
+    for (int index : object_index) {
+        strategies[index].object = objects[index];
+        tag_batch[objects[index].tag].push_back(&strategies[index]);
+    }
 
-        strategy.object = object;
-        std::vector<int> group_ids;
-        // 提取出可以放置该物品的 group
-        for (int i = 0; i < tot_group; i++) {
-            int disk_id = group_disk_slice[i][0].first;
-            int slice_id = group_disk_slice[i][0].second;
-            Disk& disk = global::disks[disk_id];
-            if (disk.slice_empty_block_num[slice_id] >= object.size) {
-                group_ids.push_back(i);
-            }
+    long long batch_budget_end = group_key_count + BATCH_PLACEMENT_BUDGET;
+    for (int index : object_index) {
+        ObjectWriteStrategy& strategy = strategies[index];
+        if (!strategy.block_id[0].empty()) {
+            // 已经随着同一个 tag 的批次放置
+            continue;
         }
-        if (group_ids.empty()) {
-            // 应该不会出现这种情况
-            throw std::runtime_error("No disk can be used.");
-        }
-
-        // 按照某些优先级给 group 排序
-        auto group_key = [&](const int& group_id) {
-            struct GroupValue {
-                bool has_tag;
-                bool is_empty;
-                int tag_num;
-                int empty_block_num;
-                bool is_dominant;  // 是否是 tag 主导的 slice
-                // 所在的 disk 的相关信息
-                int empty_slice_num;
-                int tag_slice_num;
-
-                bool operator<(const GroupValue& other) const {
-                    // 优先拥有 tag
-                    if (has_tag != other.has_tag) {
-                        return has_tag > other.has_tag;
-                    }
-                    if (has_tag) {
-                        // 优先纯色的 slice
-                        if (tag_num != other.tag_num) {
-                            return tag_num < other.tag_num;
-                        }
-                        if (is_dominant) {
-                            // 优先空闲块数少的 slice（优先放满）
-                            if (empty_block_num != other.empty_block_num) {
-                                return empty_block_num < other.empty_block_num;
-                            }
-                        } else {
-                            // 优先 tag 数量少的 slice
-                            if (tag_num != other.tag_num) {
-                                return tag_num < other.tag_num;
-                            }
-                            // 优先空闲块数多的 slice
-                            if (empty_block_num != other.empty_block_num) {
-                                return empty_block_num > other.empty_block_num;
-                            }
-                            // 优先相同的 tag 较少的 disk（负载均衡）
-                            if (tag_slice_num != other.tag_slice_num) {
-                                return tag_slice_num < other.tag_slice_num;
-                            }
-                        }
-                    } else {
-                        // 优先空闲的 slice
-                        if (is_empty != other.is_empty) {
-                            return is_empty > other.is_empty;
-                        }
-                        if (is_empty) {
-                            // 优先相同的 tag 较少的 disk（负载均衡）
-                            if (tag_slice_num != other.tag_slice_num) {
-                                return tag_slice_num < other.tag_slice_num;
-                            }
-                            // 优先空闲 slice 数多的 disk
-                            if (empty_slice_num != other.empty_slice_num) {
-                                return empty_slice_num > other.empty_slice_num;
-                            }
-                        } else {
-                            // 优先 tag 数量少的 slice
-                            if (tag_num != other.tag_num) {
-                                return tag_num < other.tag_num;
-                            }
-                            // 优先空闲块数多的 slice
-                            if (empty_block_num != other.empty_block_num) {
-                                return empty_block_num > other.empty_block_num;
-                            }
-                            // 优先相同的 tag 较少的 disk（负载均衡）
-                            if (tag_slice_num != other.tag_slice_num) {
-                                return tag_slice_num < other.tag_slice_num;
-                            }
-                        }
-                    }
-                    return false;
-                }
-            };
-            int disk_id = group_disk_slice[group_id][0].first;
-            int slice_id = group_disk_slice[group_id][0].second;
-            Disk& disk = global::disks[disk_id];
-            // 计算 slice 的信息
-            bool has_tag = (disk.slice_tag[slice_id] & (1 << object.tag)) == (1 << object.tag);
-            int tag_num = __builtin_popcount(disk.slice_tag[slice_id]);
-            int empty_block_num = disk.slice_empty_block_num[slice_id];
-            bool is_empty = (empty_block_num == disk.slice_end[slice_id] - disk.slice_start[slice_id] + 1);
-
-            // 由于三三分组，这里选择三个 slice 所在 disk 中拥有最少 slice 数的硬盘作为参考
-            int min_empty_slice_num = global::disks[disk_id].slice_num;
-            for (int i = 0; i < 3; i++) {
-                int disk_id = group_disk_slice[group_id][i].first;
-                Disk& disk = global::disks[disk_id];
-                int empty_slice_num = 0;
-                for (int j = 1; j <= disk.slice_num; j++) {
-                    if (disk.slice_empty_block_num[j] == disk.slice_end[j] - disk.slice_start[j] + 1) {
-                        empty_slice_num++;
-                    }
-                }
-                min_empty_slice_num = std::min(min_empty_slice_num, empty_slice_num);
+        auto& batch = tag_batch[strategy.object.tag];
+        if (batch.size() > 1 && group_key_count < batch_budget_end) {
+            if (place_batch(batch)) {
+                continue;
             }
+        }
+        // 这个 tag 剩下的对象都逐个放置，批次中可能已经有放置过的对象，不再使用
+        batch.clear();
+        place_greedy(strategy);
+    }
 
-            // 由于三三分组，这里选择三个 slice 所在 disk 中拥有最多相同 tag 的 slice 数的硬盘作为参考
-            int max_tag_slice_num = 0;
-            for (int i = 0; i < 3; i++) {
-                int disk_id = group_disk_slice[group_id][i].first;
-                Disk& disk = global::disks[disk_id];
-                int tag_slice_num = 0;
-                for (int j = 1; j <= disk.slice_num; j++) {
-                    if (disk.slice_tag[j] & (1 << object.tag)) {
-                        tag_slice_num++;
-                    }
+    return strategies;
+}
+
+// -------------------------请求分配-------------------------
+// 对象的每个分块上的未完成请求只会被分配到一个副本上，避免三个硬盘重复统计同一个请求的 gain 和 request_num
+// 一个请求完成只需要每个块在任意一个副本上被读取过，因此不同的块可以分给不同的副本，由多个磁头同时读取
+
+// 第 copy_id 个副本上是否有磁头正在扫描，并且还没有经过 pos
+inline bool is_covered(const Object& object, int copy_id, int pos) {
+    int disk_id = object.disk_id[copy_id];
+    const Disk& disk = global::disks[disk_id];
+    for (int head_id = 0; head_id < 2; head_id++) {
+        int head = disk.head[head_id];
+        if (!should_jmp[disk_id][head_id] && disk.slice_id[head] == object.slice_id[copy_id] && head <= pos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 估计在第 copy_id 个副本上读到 object 第 block_index 个块需要的时间片数
+inline double replica_read_cost(const Object& object, int copy_id, int block_index) {
+    int disk_id = object.disk_id[copy_id];
+    const Disk& disk = global::disks[disk_id];
+    int slice_id = object.slice_id[copy_id];
+    int pos = object.block_id[copy_id][block_index];
+    int true_G = global::G + global::g[(global::timestamp - 1) / 1800 + 1];
+    // 顺着扫到这个块时需要读取这个副本上位置不在它之后的所有块，扫描途中 READ 链已经稳定，按最小的 READ 消耗计算
+    int read_num = std::count_if(object.block_id[copy_id].begin() + 1, object.block_id[copy_id].end(),
+                                 [&](int other) { return other <= pos; });
+    double read_tokens = TokenCost::chain_cost(TokenCost::CHAIN_LEN, read_num);
+    // 有磁头正在这个 slice 中扫描并且还没有经过这个块，只需要顺着扫过去
+    int nearest_head = 0;
+    for (int head_id = 0; head_id < 2; head_id++) {
+        int head = disk.head[head_id];
+        if (!should_jmp[disk_id][head_id] && disk.slice_id[head] == slice_id && head <= pos) {
+            nearest_head = std::max(nearest_head, head);
+        }
+    }
+    if (nearest_head != 0) {
+        return (pos - nearest_head + read_tokens) / true_G;
+    }
+    // 否则需要一次跳转，再从 slice 开头扫到这个块，同时需要等待硬盘上其它 slice 的请求被两个磁头处理
+    double sweep = (pos - disk.slice_start[slice_id] + read_tokens) / true_G;
+    double queue = 1.0 * TokenCost::MIN_READ_COST * (disk.total_request_num - disk.slice_request_num[slice_id]) / (2.0 * true_G);
+    return 1 + sweep + queue;
+}
+
+// 按照 block_copy 重新分配 object 的所有未完成请求，请求保留原本的到达时间
+inline void reassign_blocks(Object& object, const std::vector<int>& block_copy) {
+    for (int i = 0; i < 3; i++) {
+        Disk& disk = global::disks[object.disk_id[i]];
+        for (const auto& [req_id, request] : object.read_requests) {
+            disk.erase_request(object, req_id);
+        }
+    }
+    object.block_copy = block_copy;
+    for (int i = 0; i < 3; i++) {
+        if (std::find(block_copy.begin() + 1, block_copy.end(), i) == block_copy.end()) {
+            continue;
+        }
+        Disk& disk = global::disks[object.disk_id[i]];
+        for (const auto& [req_id, request] : object.read_requests) {
+            disk.query(object, req_id, global::timestamp - request.timestamp);
+            // 原本包揽这个请求的磁头可能已经不再负责它，需要重新统计收益
+            object.unclean_gain_requests.insert(req_id);
+        }
+    }
+}
+
+// 给新的读取请求分配副本：对象已经有请求时跟随之前的分配，否则每个块选择最快能读到它的副本
+inline void assign_request(Object& object, int req_id) {
+    if (object.block_copy[1] == -1) {
+        for (int i = 1; i <= object.size; i++) {
+            int best_copy = 0;
+            double best_cost = replica_read_cost(object, 0, i);
+            for (int j = 1; j < 3; j++) {
+                double cost = replica_read_cost(object, j, i);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_copy = j;
                 }
-                max_tag_slice_num = std::max(max_tag_slice_num, tag_slice_num);
             }
+            object.block_copy[i] = best_copy;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        if (std::find(object.block_copy.begin() + 1, object.block_copy.end(), i) != object.block_copy.end()) {
+            global::disks[object.disk_id[i]].query(object, req_id);
+        }
+    }
+}
 
-            bool is_dominant = true;
-            for (int i = 1; i <= global::M; i++) {
-                if (i == object.tag) continue;
-                if (disk.slice_tag_writed_num[slice_id][i] > disk.slice_tag_writed_num[slice_id][object.tag]) {
-                    is_dominant = false;
-                    break;
-                }
+// 磁头跳转到 target 之后，把 target 之后没有被其它磁头覆盖的块的请求转移到这个硬盘上
+inline void reassign_after_jump(Disk& disk, int target) {
+    int slice_id = disk.slice_id[target];
+    for (int pos = target; pos <= disk.slice_end[slice_id]; pos++) {
+        ObjectBlock& block = disk.blocks[pos];
+        if (block.object_id == 0 || block.object_block_index != 1) continue;
+        Object& object = global::objects[block.object_id];
+        int copy_id = disk.get_copy_id(object);
+        if (object.read_requests.empty() || object.min_pos[copy_id] < target) {
+            continue;
+        }
+        std::vector<int> block_copy = object.block_copy;
+        for (int i = 1; i <= object.size; i++) {
+            int old_copy = block_copy[i];
+            if (old_copy != copy_id && !is_covered(object, old_copy, object.block_id[old_copy][i])) {
+                block_copy[i] = copy_id;
             }
+        }
+        if (block_copy != object.block_copy) {
+            reassign_blocks(object, block_copy);
+        }
+    }
+}
 
-            return GroupValue{has_tag, is_empty, tag_num, empty_block_num, is_dominant, min_empty_slice_num,
-                              max_tag_slice_num};
-        };
-        auto slice_cmp = [&](const int& group_id1, const int& group_id2) {
-            return group_key(group_id1) < group_key(group_id2);
-        };
-        // std::shuffle(group_ids.begin(), group_ids.end(), global::rng);
-        auto it = std::min_element(group_ids.begin(), group_ids.end(), slice_cmp);
-        // 选出最优的 group_id
-        auto group_id = *it;
-        // 选好了硬盘和 slice，开始放置
+// 清理所有块都在 head 之后的对象的收益，slice_unclean_objects 按最小块号排序，只需要访问 head 之后的对象
+inline void clean_gain_after_head(Disk& disk, int head) {
+    auto& unclean_objects = disk.slice_unclean_objects[disk.slice_id[head]];
+    for (auto it = unclean_objects.lower_bound({head, 0}); it != unclean_objects.end();) {
+        Object& object = global::objects[it->second];
+        it = unclean_objects.erase(it);
+        // 这个硬盘上已经没有这个对象的查询时不负责清理，之后重新查询时会再加入
+        int copy_id = disk.get_copy_id(object);
+        bool has_request = false;
+        for (int i = 1; i <= object.size; i++) {
+            if (disk.request_num[object.block_id[copy_id][i]] != 0) {
+                has_request = true;
+                break;
+            }
+        }
+        if (!has_request || object.unclean_gain_requests.empty()) continue;
+        // 磁头会扫过这个对象的所有块，分配到其它副本的块也转移到这个硬盘上，之后清理 gain
+        std::vector<int> block_copy = object.block_copy;
+        std::fill(block_copy.begin() + 1, block_copy.end(), copy_id);
+        if (block_copy != object.block_copy) {
+            reassign_blocks(object, block_copy);
+        }
         for (int i = 0; i < 3; i++) {
-            int disk_id = group_disk_slice[group_id][i].first;
-            int slice_id = group_disk_slice[group_id][i].second;
-            strategy.disk_id[i] = disk_id;
-            strategy.slice_id[i] = slice_id;
-            strategy.block_id[i] = put_forward(disk_id, slice_id, object.size);
+            Disk& disk = global::disks[object.disk_id[i]];
+            disk.clean_object_gain(object);
+            disk.untrack_unclean_object(object);
         }
+        object.clean_gain();
+    }
+}
 
-        // 保证第二个硬盘上的顺序和第一个硬盘上不一样（put_back 本身就会反向放置）
-        // if (strategy.disk_id[1] % 2 == strategy.disk_id[0] % 2) {
-        //     std::reverse(strategy.block_id[1].begin() + 1, strategy.block_id[1].end());
-        // }
+// 磁头提前离开 slice 时，前方已经被清理收益的请求需要重新计入收益，否则这些请求不会再被选中
+inline void restore_gain_after_head(Disk& disk, int head) {
+    int end_pos = disk.slice_end[disk.slice_id[head]];
+    std::vector<int> object_ids;
+    for (int pos = disk.requested.next(head); pos != 0 && pos <= end_pos; pos = disk.requested.next(pos + 1)) {
+        object_ids.push_back(disk.blocks[pos].object_id);
+    }
+    std::sort(object_ids.begin(), object_ids.end());
+    object_ids.erase(std::unique(object_ids.begin(), object_ids.end()), object_ids.end());
+    for (int object_id : object_ids) {
+        Object& object = global::objects[object_id];
+        if (object.unclean_gain_requests.size() != object.read_requests.size()) {
+            reassign_blocks(object, object.block_copy);
+        }
+    }
+}
 
-        // 随机打乱第三个硬盘上的顺序
-        // tmp[i]是第i个盘放哪个对象块
-        // std::shuffle(strategy.block_id[2].begin() + 1, strategy.block_id[2].end(), global::rng);
-        write_object(strategy);
+// -------------------------磁头策略-------------------------
+// COST[n] 是第 n 次连续 READ 所消耗的令牌，0 是 PASS 时的消耗，第 8 次往后都是 16
+constexpr auto& COST = TokenCost::READ_COST;
+constexpr int COST_SIZE = TokenCost::STATE_NUM;
+
+// dp 状态：每种 READ 链状态下的最大剩余令牌，-1 表示不可达
+using DpState = std::array<int, COST_SIZE>;
+
+// 逐块的状态转移：从 prev 处理下一个块，有查询的块（requested）不能 PASS，pre 记录前驱状态
+inline void relax_block(const DpState& prev, bool requested, DpState& cur, DpState& pre) {
+    cur.fill(-1);
+    pre.fill(0);
+    if (!requested) {
+        int max_budget_read_count = std::max_element(prev.begin(), prev.end()) - prev.begin();
+        if (prev[max_budget_read_count] > 0) {
+            cur[0] = prev[max_budget_read_count] - COST[0];
+            pre[0] = max_budget_read_count;
+        }
+    }
+    for (int j = 0; j < COST_SIZE; j++) {
+        if (prev[j] == -1) continue;
+        int next_j = std::min(j + 1, COST_SIZE - 1);
+        if (prev[j] - COST[next_j] > cur[next_j]) {
+            cur[next_j] = prev[j] - COST[next_j];
+            pre[next_j] = j;
+        }
     }
+}
 
-    return strategies;
+// 整段转移的选择：从前驱状态 pre 出发，先 PASS pass 个块，再 READ read 个块
+struct SegmentChoice {
+    int pre;
+    int pass;
+    int read;
+};
+
+// 整段的状态转移，段内的决策只和段长以及 READ 链的状态有关
+// 有查询的段只能全部 READ；没有查询的段要么全部 READ（保持 READ 链），要么先 PASS，再 READ 最后的 k 个块来预热 READ 链
+// 在段中间 PASS 之后再 READ 超过 COST_SIZE - 1 个块，或者 READ 之后再 PASS，都不会更优
+inline void relax_segment(const DpState& prev, int len, bool requested, DpState& cur,
+                          std::array<SegmentChoice, COST_SIZE>& choice) {
+    cur.fill(-1);
+    for (int j = 0; j < COST_SIZE; j++) {
+        if (prev[j] == -1) continue;
+        int next_j = std::min(j + len, COST_SIZE - 1);
+        int budget = prev[j] - TokenCost::chain_cost(j, len);
+        if (budget > cur[next_j]) {
+            cur[next_j] = budget;
+            choice[next_j] = SegmentChoice{j, 0, len};
+        }
+    }
+    if (!requested) {
+        int max_budget_read_count = std::max_element(prev.begin(), prev.end()) - prev.begin();
+        for (int k = 0; k < COST_SIZE && k < len; k++) {
+            int budget = prev[max_budget_read_count] - (len - k) * COST[0] - TokenCost::CHAIN_COST[0][k];
+            if (budget > cur[k]) {
+                cur[k] = budget;
+                choice[k] = SegmentChoice{max_budget_read_count, len - k, k};
+            }
+        }
+    }
 }
 
-// -------------------------磁头策略-------------------------
+// 从 pos 开始的极长段的长度，以及这一段是否有查询，到达硬盘末尾时绕回开头
+inline std::pair<int, bool> next_segment(const Disk& disk, int pos) {
+    if (disk.requested.test(pos)) {
+        int len = disk.request_ranges.find(pos).r - pos + 1;
+        if (pos + len - 1 == disk.v && disk.requested.test(1)) {
+            len += disk.request_ranges.find(1).r;
+        }
+        return {len, true};
+    }
+    int next_pos = disk.requested.next(pos);
+    if (next_pos != 0) {
+        return {next_pos - pos, false};
+    }
+    next_pos = disk.requested.next(1);
+    return {disk.v - pos + (next_pos == 0 ? 1 : next_pos), false};
+}
+
+// 规划磁头在这个时间片内的动作：在令牌允许的范围内走得尽可能远，并且最后一个动作是 READ
+// 按照有查询/没有查询的段整段推进，只有最后两段需要逐块规划，规划的代价和范围内的段数成正比
+// scan_length 不为空时返回规划扫描过的块数，规划只依赖这些块（以及之后的一个块）是否有查询
+inline HeadStrategy plan_sweep(const Disk& disk, int head_id, int true_G, int* scan_length = nullptr) {
+    HeadStrategy strategy;
+    int read_count = 0;
+    if (disk.pre_action[head_id] == HeadActionType::READ) {
+        read_count = TokenCost::read_state(disk.pre_action_cost[head_id]);
+    }
+    // boundary[i] 表示走完前 i 段之后的状态，choices[i] 是第 i 段的转移
+    std::vector<DpState> boundary(1);
+    std::vector<std::array<SegmentChoice, COST_SIZE>> choices;
+    std::vector<std::pair<int, int>> segments;  // (起点, 长度)
+    std::vector<char> segment_requested;
+    boundary[0].fill(-1);
+    boundary[0][read_count] = true_G;
+    for (int pos = disk.head[head_id], total = 0; total < disk.v;) {
+        auto [len, requested] = next_segment(disk, pos);
+        len = std::min(len, disk.v - total);
+        segments.push_back({pos, len});
+        segment_requested.push_back(requested);
+        DpState cur;
+        std::array<SegmentChoice, COST_SIZE> choice;
+        relax_segment(boundary.back(), len, requested, cur, choice);
+        if (std::all_of(cur.begin(), cur.end(), [](int x) { return x == -1; })) {
+            break;
+        }
+        boundary.push_back(cur);
+        choices.push_back(choice);
+        pos = (pos - 1 + len) % disk.v + 1;
+        total += len;
+    }
+    if (scan_length != nullptr) {
+        *scan_length = 0;
+        for (const auto& segment : segments) {
+            *scan_length += segment.second;
+        }
+    }
+
+    // 最后一段走不完，从倒数第二段开始逐块规划
+    int full_segment_num = choices.size();
+    int block_start = std::max(full_segment_num - 1, 0);
+    std::vector<DpState> dp(1, boundary[block_start]), pre(1);
+    for (int i = block_start; i < (int)segments.size(); i++) {
+        bool stop = false;
+        for (int k = 0, p = segments[i].first; k < segments[i].second; k++, p = p % disk.v + 1) {
+            DpState cur, cur_pre;
+            relax_block(dp.back(), segment_requested[i], cur, cur_pre);
+            if (std::all_of(cur.begin(), cur.end(), [](int x) { return x == -1; })) {
+                stop = true;
+                break;
+            }
+            dp.push_back(cur);
+            pre.push_back(cur_pre);
+        }
+        if (stop) break;
+    }
+    // 去掉末尾不能以 READ 结束的位置
+    while (dp.size() > 1 && std::all_of(dp.back().begin() + 1, dp.back().end(), [](int x) { return x == -1; })) {
+        dp.pop_back();
+        pre.pop_back();
+    }
+
+    // 倒序生成动作
+    int end_segment, state;
+    if (dp.size() > 1) {
+        state = std::max_element(dp.back().begin() + 1, dp.back().end()) - dp.back().begin();
+        for (int i = dp.size() - 1; i >= 1; i--) {
+            strategy.add_action(state == 0 ? HeadActionType::PASS : HeadActionType::READ);
+            state = pre[i][state];
+        }
+        end_segment = block_start;
+    } else {
+        // 逐块规划的范围内无法以 READ 结束，回退到之前最后一个能以 READ 结束的段
+        end_segment = block_start;
+        while (end_segment > 0 &&
+               std::all_of(boundary[end_segment].begin() + 1, boundary[end_segment].end(), [](int x) { return x == -1; })) {
+            end_segment--;
+        }
+        if (end_segment == 0) {
+            return strategy;
+        }
+        state = std::max_element(boundary[end_segment].begin() + 1, boundary[end_segment].end()) -
+                boundary[end_segment].begin();
+    }
+    for (int i = end_segment - 1; i >= 0; i--) {
+        const SegmentChoice& choice = choices[i][state];
+        for (int k = 0; k < choice.read; k++) {
+            strategy.add_action(HeadActionType::READ);
+        }
+        for (int k = 0; k < choice.pass; k++) {
+            strategy.add_action(HeadActionType::PASS);
+        }
+        state = choice.pre;
+    }
+    std::reverse(strategy.actions.begin(), strategy.actions.end());
+    return strategy;
+}
+
+// 读取 disk 上 pos 这个块能得到的价值：分配到这个副本并且还没有读取这个块的请求，每个请求的价值平摊到对象的每个块上
+inline double block_value(const Disk& disk, int pos) {
+    const ObjectBlock& block = disk.blocks[pos];
+    if (block.object_id == 0 || disk.request_num[pos] == 0) {
+        return 0;
+    }
+    const Object& object = global::objects[block.object_id];
+    int copy_id = disk.get_copy_id(object);
+    if (object.block_copy[block.object_block_index] != copy_id) {
+        return 0;
+    }
+    double value = 0;
+    for (const auto& [req_id, request] : object.read_requests) {
+        if (!request.readed[block.object_block_index]) {
+            value += RequestValue::age_weight(global::timestamp - request.timestamp);
+        }
+    }
+    return value * RequestValue::size_weight(object.size) / object.size;
+}
+
+// 选择跳转到 slice_id 后的落点：跳转之后的下一个时间片从落点往后扫描，用前缀和估计每个落点在这个时间片内
+// 能读到的查询价值，选择收益最大的位置。返回 0 表示 slice 中没有查询
+inline int best_jump_target(const Disk& disk, int slice_id) {
+    int start = disk.slice_start[slice_id], end = disk.slice_end[slice_id];
+    int first = disk.requested.next(start);
+    if (first == 0 || first > end) {
+        return 0;
+    }
+    int last = disk.requested.prev(end);
+    // 前缀和，prefix[i] 表示 [first, first + i) 中的查询价值
+    std::vector<double> prefix(last - first + 2);
+    for (int i = first; i <= last; i++) {
+        prefix[i - first + 1] = prefix[i - first] + block_value(disk, i);
+    }
+    // 估计下一个时间片能扫过的块数：有查询的块按连续 READ 的消耗计算，其它的块按 PASS 计算
+    int true_G = global::G + global::g[(global::timestamp - 1) / 1800 + 1];
+    double density = (double)disk.requested.count(first, last) / (last - first + 1);
+    int window = std::max(1, (int)((true_G - COST[1]) / (density * TokenCost::MIN_READ_COST +
+                                                         (1 - density) * TokenCost::PASS_COST)));
+    // 落点之前的查询需要等到下一次扫描这个 slice 时才能被读取，从收益中扣除
+    int best = first;
+    double best_value = std::numeric_limits<double>::lowest();
+    for (int p = first; p != 0 && p <= last; p = disk.requested.next(p + 1)) {
+        double window_value = prefix[std::min(last, p + window - 1) - first + 1] - prefix[p - first];
+        double value = window_value - prefix[p - first];
+        if (value > best_value) {
+            best_value = value;
+            best = p;
+        }
+    }
+    return best;
+}
+
+// 估计 slice 在当前时间窗口内每个时间片的请求到达量：每个 tag 的读取量按 slice 中这个 tag 的块数占比分摊
+inline std::vector<double> expected_slice_arrival(const Disk& disk) {
+    int window = std::min((global::timestamp + 1799) / 1800, global::fre_len);
+    std::vector<double> arrival(disk.slice_num + 1);
+    for (int tag = 1; tag <= global::M; tag++) {
+        if (!disk.has_tag(tag) || global::fre_read[tag][window] == 0) continue;
+        // 每个块有 3 个副本，读取量平均分摊到所有副本上
+        int tag_block_num = 0;
+        for (int i = 1; i <= global::N; i++) {
+            tag_block_num += global::disks[i].tag_writed_num[tag];
+        }
+        double tag_arrival = 1.0 * global::fre_read[tag][window] / 1800 / tag_block_num;
+        for (int i = 1; i <= disk.slice_num; i++) {
+            arrival[i] += tag_arrival * disk.slice_tag_writed_num[i][tag];
+        }
+    }
+    return arrival;
+}
+
+// 硬盘上没有请求时，把磁头提前移动到预计请求最多的两个 slice 的开头，请求到达之后可以不用跳转直接读取
+inline HeadStrategy idle_strategy(int disk_id, int head_id) {
+    Disk& disk = global::disks[disk_id];
+    HeadStrategy strategy;
+    std::vector<double> arrival = expected_slice_arrival(disk);
+    std::vector<int> order(disk.slice_num);
+    std::iota(order.begin(), order.end(), 1);
+    std::sort(order.begin(), order.end(), [&arrival](int a, int b) { return arrival[a] > arrival[b]; });
+
+    int slice_id = disk.slice_id[disk.head[head_id]];
+    int other_slice_id = disk.slice_id[disk.head[head_id ^ 1]];
+    int target_slice = 0;
+    for (int i = 0; i < 2 && i < disk.slice_num; i++) {
+        if (arrival[order[i]] == 0) break;
+        // 两个磁头在同一个 slice 中时，让 1 号磁头离开
+        if (order[i] == slice_id && (slice_id != other_slice_id || head_id == 0)) {
+            target_slice = slice_id;
+            break;
+        }
+        if (order[i] != other_slice_id && target_slice == 0) {
+            target_slice = order[i];
+        }
+    }
+    if (target_slice == 0) {
+        return strategy;
+    }
+    idle_positioned[disk_id][head_id] = true;
+    should_jmp[disk_id][head_id] = false;
+    if (target_slice != slice_id) {
+        strategy.add_action(HeadActionType::JUMP, disk.slice_start[target_slice]);
+    }
+    return strategy;
+}
+
+// 比较继续扫描和立即跳转在接下来 JUMP_HORIZON 个时间片内能得到的价值，跳转的价值超过 JUMP_MARGIN 倍时提前跳转
+constexpr int JUMP_HORIZON = 3;
+constexpr double JUMP_MARGIN = 8;
+
+inline bool should_jump_early(const Disk& disk, int head_id, int true_G) {
+    int head = disk.head[head_id];
+    int slice_id = disk.slice_id[head];
+    // 继续扫描：按照连续 READ 估计令牌，累计能读到的块的价值
+    double continue_value = 0;
+    int tokens = JUMP_HORIZON * true_G, read_num = 0;
+    for (int pos = disk.requested.next(head); pos != 0 && pos <= disk.slice_end[slice_id];
+         pos = disk.requested.next(pos + 1)) {
+        read_num++;
+        if (TokenCost::chain_cost(0, read_num) + TokenCost::PASS_COST * (pos - head + 1 - read_num) > tokens) {
+            break;
+        }
+        continue_value += block_value(disk, pos);
+    }
+    // 跳转：损失一个时间片，之后扫描收益最高的 slice，另一个磁头正在扫描的 slice 不考虑
+    int other_head = disk.head[head_id ^ 1];
+    int other_slice_id = should_jmp[disk.disk_id][head_id ^ 1] ? 0 : disk.slice_id[other_head];
+    double jump_value = 0;
+    for (int i = 1; i <= disk.slice_num; i++) {
+        if (i == slice_id || i == other_slice_id) continue;
+        double gain = disk.get_slice_gain(i);
+        if (gain == 0) continue;
+        int sweep_cost = std::max(1, disk.get_slice_sweep_cost(i));
+        jump_value = std::max(jump_value, gain * std::min(1.0, 1.0 * (JUMP_HORIZON - 1) * true_G / sweep_cost));
+    }
+    return jump_value > JUMP_MARGIN * continue_value;
+}
+
+// -------------------------预测规划-------------------------
+// 等待下一个时间片的输入时，后台线程按照当前状态预先计算 slice 的收益和磁头的规划
+// 下一个时间片的删除、写入、读取会修改状态，使用时用版本号检查依赖的 slice 是否变化，只重新计算变化了的部分
+// 超时判断依赖这个时间片磁头移动之后的位置，提前计算几乎都会失效，因此不做预测
+
+struct SpeculativePlan {
+    bool valid = false;
+    int head;
+    HeadActionType pre_action;
+    int pre_action_cost;
+    int true_G;
+    std::vector<std::pair<int, int>> slice_versions;  // 规划扫描过的 (slice_id, slice_request_version)
+    HeadStrategy strategy;
+};
+inline std::vector<std::array<SpeculativePlan, 2>> speculative_plans;
+inline long long speculative_plan_hit, speculative_plan_miss;
+
+inline SpeculativePlan make_speculative_plan(const Disk& disk, int head_id, int true_G) {
+    SpeculativePlan plan{true, disk.head[head_id], disk.pre_action[head_id], disk.pre_action_cost[head_id], true_G,
+                         {}, {}};
+    int scan_length = 0;
+    plan.strategy = plan_sweep(disk, head_id, true_G, &scan_length);
+    // 记录扫描过的块以及之后一个块所在的 slice 的版本
+    for (int pos = plan.head, remain = std::min(scan_length + 1, disk.v); remain > 0;) {
+        int slice_id = disk.slice_id[pos];
+        plan.slice_versions.push_back({slice_id, disk.slice_request_version[slice_id]});
+        // 硬盘末尾不足一个 slice 的块也被算在最后一个 slice 中
+        int end_pos = pos <= disk.slice_end[slice_id] ? disk.slice_end[slice_id] : disk.v;
+        int step = std::min(remain, end_pos - pos + 1);
+        remain -= step;
+        pos = (pos - 1 + step) % disk.v + 1;
+    }
+    return plan;
+}
+
+inline bool is_speculative_plan_valid(const Disk& disk, int head_id, int true_G, const SpeculativePlan& plan) {
+    if (!plan.valid || plan.head != disk.head[head_id] || plan.pre_action != disk.pre_action[head_id] ||
+        plan.pre_action_cost != disk.pre_action_cost[head_id] || plan.true_G != true_G) {
+        return false;
+    }
+    return std::all_of(plan.slice_versions.begin(), plan.slice_versions.end(), [&disk](const auto& slice_version) {
+        return disk.slice_request_version[slice_version.first] == slice_version.second;
+    });
+}
+
+// 规划磁头在这个时间片内的扫描，状态没有变化时直接使用之前的规划
+inline const HeadStrategy& cached_plan_sweep(const Disk& disk, int head_id, int true_G) {
+    SpeculativePlan& plan = speculative_plans[disk.disk_id][head_id];
+    if (is_speculative_plan_valid(disk, head_id, true_G, plan)) {
+        speculative_plan_hit++;
+    } else {
+        speculative_plan_miss++;
+        plan = make_speculative_plan(disk, head_id, true_G);
+    }
+    return plan.strategy;
+}
+
+// 后台线程：只读取磁盘的状态，写入 speculative_plans 和 slice 收益的缓存
+inline void speculate(int next_timestamp) {
+    int true_G = global::G + global::g[(next_timestamp - 1) / 1800 + 1];
+    for (int i = 1; i <= global::N; i++) {
+        const Disk& disk = global::disks[i];
+        for (int j = 1; j <= disk.slice_num; j++) {
+            disk.get_slice_gain(j);
+        }
+        if (disk.total_request_num == 0) continue;
+        for (int head_id = 0; head_id < 2; head_id++) {
+            if (should_jmp[i][head_id] || is_speculative_plan_valid(disk, head_id, true_G, speculative_plans[i][head_id])) {
+                continue;
+            }
+            speculative_plans[i][head_id] = make_speculative_plan(disk, head_id, true_G);
+        }
+    }
+}
+
+// 后台线程只创建一次，每个时间片由主线程通知开始，空闲时阻塞在条件变量上
+class SpeculationWorker {
+   public:
+    void start(int next_timestamp) {
+        if (!thread_.joinable()) {
+            thread_ = std::thread([this] { loop(); });
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            next_timestamp_ = next_timestamp;
+            busy_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // 等待这一次预测结束
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !busy_; });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !busy_; });
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+   private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return busy_ || stopped_; });
+            if (stopped_) return;
+            int next_timestamp = next_timestamp_;
+            lock.unlock();
+            speculate(next_timestamp);
+            lock.lock();
+            busy_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int next_timestamp_ = 0;
+    bool busy_ = false;
+    bool stopped_ = false;
+};
+inline SpeculationWorker speculation_worker;
+
+// 在一个时间片的输出结束之后调用，和读取下一个时间片的输入同时进行
+// 只有一个核时后台线程只会和主线程抢占时间，不做预测，规划的缓存仍然可以省掉同一个时间片内的重复规划
+inline void start_speculation(int next_timestamp) {
+    static const bool enabled = std::thread::hardware_concurrency() > 1;
+    if (enabled) {
+        speculation_worker.start(next_timestamp);
+    }
+}
+
+// 在修改任何状态之前调用
+inline void finish_speculation() { speculation_worker.finish(); }
+
 // 磁头策略函数，返回 disk_id 磁头的策略
 inline HeadStrategy simulate_strategy(int disk_id, int head_id) {
     Disk& disk = global::disks[disk_id];
     HeadStrategy strategy;
     if (disk.total_request_num == 0) {
-        return strategy;
+        return idle_strategy(disk_id, head_id);
+    }
+    if (idle_positioned[disk_id][head_id]) {
+        // 提前移动的磁头没有等到所在 slice 的请求，直接跳转到有请求的 slice
+        idle_positioned[disk_id][head_id] = false;
+        if (disk.slice_request_num[disk.slice_id[disk.head[head_id]]] == 0) {
+            should_jmp[disk_id][head_id] = true;
+        }
     }
     if (should_jmp[disk_id][head_id]) {
-        // 跳转到收益最大的 slice 的可读取开头
+        // 跳转到单位令牌收益最大的 slice 的可读取开头，令牌包括跳转本身和扫完 slice 中的查询
+        int jump_cost = TokenCost::jump_cost(global::G + global::g[(global::timestamp - 1) / 1800 + 1]);
         std::vector<double> slice_gain(disk.slice_num + 1);
         for (int i = 1; i <= disk.slice_num; i++) {
-            slice_gain[i] = disk.get_slice_gain(i);
+            slice_gain[i] = disk.get_slice_gain(i) / (jump_cost + disk.get_slice_sweep_cost(i));
         }
         int max_slice_id = std::max_element(slice_gain.begin() + 1, slice_gain.end()) - slice_gain.begin();
 
         int target_slice = max_slice_id;
-        int target = disk.slice_start[target_slice];
-        while (disk.request_num[target] == 0) {
-            target = mod(target, 1, global::V, 1);
-            // target = mod(target, disk.slice_start[target_slice], disk.slice_end[target_slice], 1);
-            // if (target == disk.slice_start[target_slice]) {
-            //     break;
-            // }
+        int target = best_jump_target(disk, target_slice);
+        if (target == 0) {
+            // slice 中没有查询，找硬盘上第一个有查询的块
+            target = disk.requested.next(1);
         }
         strategy.add_action(HeadActionType::JUMP, target);
         return strategy;
     }
-    // 第 n 次 READ 时所消耗的令牌，第 8 次往后都是 16
-    // 0 是 PASS 时的消耗
-    const int COST[] = {1, 64, 52, 42, 34, 28, 23, 19, 16};
-    const int COST_SIZE = sizeof(COST) / sizeof(int);
-
-    // 动态规划
-    // dp[i][j] 表示磁头在位置 i 时，使用第 j 次 READ 后的最大剩余令牌
-    std::vector<std::array<int, COST_SIZE>> dp;
-    std::vector<std::array<int, COST_SIZE>> pre_read_count;
-    // dp.clear();
-    // pre_read_count.clear();
     int true_G = global::G + global::g[(global::timestamp - 1) / 1800 + 1];
-    for (int i = 0, p = disk.head[head_id]; i <= global::V; i++) {
-        dp.push_back(std::array<int, COST_SIZE>());
-        dp.back().fill(-1);
-        pre_read_count.push_back(std::array<int, COST_SIZE>());
-        pre_read_count.back().fill(0);
-        // 开始处的处理
-        if (i == 0) {
-            int read_count;
-            if (disk.pre_action[head_id] == HeadActionType::READ) {
-                read_count = std::lower_bound(std::begin(COST) + 1, std::end(COST), disk.pre_action_cost[head_id],
-                                              std::greater<int>()) -
-                             COST;
-            } else {
-                read_count = 0;
-            }
-            if (disk.request_num[p] == 0) {
-                // 磁头在空闲块上时才可以 PASS
-                dp[0][0] = true_G - 1;
-                pre_read_count[0][0] = read_count;
-            }
-            // READ 操作
-            if (read_count == COST_SIZE - 1) {
-                dp[0][read_count] = true_G - COST[read_count];
-                pre_read_count[0][read_count] = read_count;
-            } else {
-                dp[0][read_count + 1] = true_G - COST[read_count + 1];
-                pre_read_count[0][read_count + 1] = read_count;
-            }
-            p = mod(p, 1, global::V, 1);
-            continue;
-        }
-
-        // 计算 dp[i][j]
-        if (disk.request_num[p] == 0) {
-            // 磁头在空闲块上时才可以 PASS
-            int max_budget_read_count = std::max_element(dp[i - 1].begin(), dp[i - 1].end()) - dp[i - 1].begin();
-            int max_budget = dp[i - 1][max_budget_read_count];
-            if (max_budget != 0) {
-                if (max_budget - COST[0] > dp[i][0]) {
-                    dp[i][0] = max_budget - COST[0];
-                    pre_read_count[i][0] = max_budget_read_count;
-                }
-            }
-        }
-        // READ 操作
-        for (int j = 0; j < COST_SIZE; j++) {
-            if (dp[i - 1][j] == -1) continue;
-            if (j == COST_SIZE - 1) {
-                if (dp[i - 1][j] - COST[j] > dp[i][j]) {
-                    dp[i][j] = dp[i - 1][j] - COST[j];
-                    pre_read_count[i][j] = j;
-                }
-            } else {
-                if (dp[i - 1][j] - COST[j + 1] > dp[i][j + 1]) {
-                    dp[i][j + 1] = dp[i - 1][j] - COST[j + 1];
-                    pre_read_count[i][j + 1] = j;
-                }
-            }
-        }
-        if (std::all_of(dp[i].begin(), dp[i].end(), [](int x) { return x == -1; })) {
-            // 如果所有的 dp[i][j] 都是 -1，说明没有可用的令牌
-            dp.pop_back();
-            pre_read_count.pop_back();
-            break;
-        }
-        p = mod(p, 1, global::V, 1);
-    }
-    while (!dp.empty() && std::all_of(dp.back().begin() + 1, dp.back().end(), [](int x) { return x == -1; })) {
-        dp.pop_back();
-        pre_read_count.pop_back();
-    }
-    // 获取 dp 的方案
-    if (!dp.empty()) {
-        int dp_p = dp.size() - 1;
-        int dp_j = std::max_element(dp.back().begin() + 1, dp.back().end()) - dp.back().begin();
-        while (dp_p >= 0) {
-            if (dp_j == 0) {
-                strategy.add_action(HeadActionType::PASS);
-            } else {
-                strategy.add_action(HeadActionType::READ);
-            }
-            dp_j = pre_read_count[dp_p][dp_j];
-            dp_p--;
-        }
-        std::reverse(strategy.actions.begin(), strategy.actions.end());
-    }
+    strategy = cached_plan_sweep(disk, head_id, true_G);
 
     // 清空末尾的 pass
     while (!strategy.actions.empty() && strategy.actions.back().type == HeadActionType::PASS) {
@@ -746,11 +1412,11 @@ inline std::vector<std::array<HeadStrategy, 2>> head_strategy_function() {
         simulate_read_time[i + global::N] =
             std::count_if(strategy2.actions.begin(), strategy2.actions.end(),
                           [](const HeadAction& action) { return action.type == HeadActionType::READ; });
-        // 如果策略为空，那么强制跳转
-        if (strategy1.actions.empty()) {
+        // 如果策略为空，那么强制跳转，已经提前移动到位的空闲磁头除外
+        if (strategy1.actions.empty() && !idle_positioned[i][0]) {
             should_jmp[i][0] = true;
         }
-        if (strategy2.actions.empty()) {
+        if (strategy2.actions.empty() && !idle_positioned[i][1]) {
             should_jmp[i][1] = true;
         }
     }
@@ -771,17 +1437,23 @@ inline std::vector<std::array<HeadStrategy, 2>> head_strategy_function() {
         Disk& disk = global::disks[disk_id];
         head_strategies[disk_id][head_id] = simulate_strategy(disk_id, head_id);
         HeadStrategy& strategy = head_strategies[disk_id][head_id];
+        // 当前 slice 前方的价值远小于其它 slice 时，放弃剩下的部分，立即跳转
+        if (!strategy.actions.empty() && strategy.actions[0].type != HeadActionType::JUMP &&
+            should_jump_early(disk, head_id, global::G + global::g[(global::timestamp - 1) / 1800 + 1])) {
+            int head = disk.head[head_id];
+            should_jmp[disk_id][head_id] = true;
+            strategy = simulate_strategy(disk_id, head_id);
+            restore_gain_after_head(disk, head);
+        }
         // 判断是否已经扫完块并且下一步是否要强制跳转
         // 如果 strategy.actions.size() + disk.head[head_id] 大于最后一个有查询的块，那么下一个时间片就可以跳转
-        int slice_last_query_p = disk.slice_end[disk.slice_id[disk.head[head_id]]];
-        for (int i = disk.slice_end[disk.slice_id[disk.head[head_id]]];
-             i >= disk.slice_start[disk.slice_id[disk.head[head_id]]]; i--) {
-            if (disk.request_num[i] != 0) {
-                slice_last_query_p = i;
-                break;
-            }
+        int head_slice = disk.slice_id[disk.head[head_id]];
+        int slice_last_query_p = disk.requested.prev(disk.slice_end[head_slice]);
+        if (slice_last_query_p < disk.slice_start[head_slice]) {
+            slice_last_query_p = disk.slice_end[head_slice];
         }
         if (!strategy.actions.empty() && strategy.actions[0].type == HeadActionType::JUMP) {
+            reassign_after_jump(disk, strategy.actions[0].target);
             clean_gain_after_head(disk, strategy.actions[0].target);
             should_jmp[disk_id][head_id] = false;
         } else if ((int)strategy.actions.size() + disk.head[head_id] > slice_last_query_p) {
@@ -798,46 +1470,123 @@ inline std::vector<std::array<HeadStrategy, 2>> head_strategy_function() {
 // 放弃读取请求，需要维护 disk 和 object 的状态
 std::vector<int> give_up_16;
 std::vector<int> lst_give_up_16;
+// 估计超时的时候，假设读到物品之前已经连续 READ 的次数
+// 读取物品的消耗为 23, 19, 16, ...，物品大于 1 时比按每块 23 估计的读取时间更短，请求会更晚被放弃
+constexpr int TIMEOUT_READ_STATE = 5;
 double time_timeout, time_read, time_del, time_write, time_update;
+double time_critical;  // 从收到时间片到输出完读取结果的墙钟时间
+// 超时检查的时间轮：对象在 timeout_wheel[t % TIMEOUT_WHEEL_SIZE] 中表示需要在时间片 t 检查它的请求是否超时
+// 检查时间由读取这个对象所需时间的上界决定，在此之前它的请求一定不会被放弃，因此每个时间片只需要访问快要超时的对象
+constexpr int TIMEOUT_WHEEL_SIZE = 106;
+inline std::array<std::vector<int>, TIMEOUT_WHEEL_SIZE> timeout_wheel;
+inline std::vector<HashSet<int>> tag_pending_objects;  // 每个 tag 有未超时请求的对象，放弃率过高的 tag 会放弃全部请求
+
+// 放弃率过高的 tag，它的请求会被立即放弃
+inline bool is_give_up_tag(int tag) {
+    double opt = 1.0 * (give_up_16[tag] - lst_give_up_16[tag]) / global::fre_read[tag][(global::timestamp + 1799) / 1800];
+    return opt > 0.01;
+}
+
+// 跳转到 slice 开头之后顺着扫过去读到这个物品需要的时间片数，true_G 越小需要的时间越长
+inline int replica_timeout_read_time(const Object& object, int copy_id, int true_G, int max_pos) {
+    const Disk& disk = global::disks[object.disk_id[copy_id]];
+    // 读到这个物品时 READ 链通常已经连续读了若干次
+    return 1 + (TokenCost::chain_cost(TIMEOUT_READ_STATE, object.size) + true_G - 1 + max_pos -
+                disk.slice_start[object.slice_id[copy_id]]) /
+                   true_G;
+}
+
+// 在 timestamp 时间片检查这个对象
+inline void schedule_timeout_check(Object& object, int timestamp) {
+    if (object.timeout_check_time != 0 && object.timeout_check_time <= timestamp) {
+        return;
+    }
+    object.timeout_check_time = timestamp;
+    timeout_wheel[timestamp % TIMEOUT_WHEEL_SIZE].push_back(object.id);
+}
+
+// 按照对象最早的请求安排下一次检查：在任何磁头位置和令牌数下，读取需要的时间都不超过 max_read_time
+inline void schedule_next_timeout_check(Object& object) {
+    object.timeout_check_time = 0;
+    if (object.read_queue.empty()) {
+        tag_pending_objects[object.tag].erase(object.id);
+        return;
+    }
+    static const int min_true_G = [] {
+        int min_g = std::numeric_limits<int>::max();
+        for (int i = 1; i < (int)global::g.size(); i++) {
+            min_g = std::min(min_g, global::g[i]);
+        }
+        return global::G + min_g;
+    }();
+    int max_read_time = std::numeric_limits<int>::max();
+    for (int i = 0; i < 3; i++) {
+        const Disk& disk = global::disks[object.disk_id[i]];
+        max_read_time = std::min(max_read_time, replica_timeout_read_time(object, i, min_true_G,
+                                                                          disk.slice_end[object.slice_id[i]]));
+    }
+    schedule_timeout_check(object, std::max(global::timestamp + 1, object.read_queue.front().timestamp + 105 - max_read_time));
+}
+
+// 新的读取请求需要在调用 add_request 之后调用
+inline void track_request_timeout(Object& object) {
+    tag_pending_objects[object.tag].insert(object.id);
+    if (object.timeout_check_time == 0) {
+        // 刚加入的请求在这个时间片就可能超时
+        schedule_timeout_check(object, global::timestamp);
+    }
+}
+
+// 检查对象的请求是否超时，放弃超时的请求
+inline void check_timeout(Object& object, int true_G, std::vector<int>& timeout_read_requests) {
+    int predict_time = 105;      // 需要被丢掉的预测时间
+    int used_time = 0x3f3f3f3f;  // 读取该物品所需要的最小时间
+    for (int i = 0; i < 3; i++) {
+        Disk& disk = global::disks[object.disk_id[i]];
+        int disk_used_time = 0x3f3f3f3f;
+        if (disk.slice_id[disk.head[0]] == object.slice_id[i]) {
+            disk_used_time = 0;
+        } else if (disk.slice_id[disk.head[1]] == object.slice_id[i]) {
+            disk_used_time = 0;
+        } else {
+            disk_used_time = replica_timeout_read_time(object, i, true_G, object.max_pos[i]);
+        }
+        if (is_give_up_tag(object.tag)) disk_used_time = 105;
+        used_time = std::min(used_time, disk_used_time);
+    }
+    predict_time -= used_time;
+    auto temp_timeout_read_requests = object.get_timeout_requests(global::timestamp, predict_time);
+    for (auto req_id : temp_timeout_read_requests) {
+        timeout_read_requests.push_back(req_id);
+        give_up_16[object.tag]++;
+        give_up_request(req_id);
+    }
+}
+
 inline std::vector<int> timeout_read_requests_function() {
     double st = 1.0 * std::clock() / CLOCKS_PER_SEC, ed;
     std::vector<int> timeout_read_requests;
-    std::vector<int> finish_G(6);
-    //{1, 64, 52, 42, 34, 28, 23, 19, 16};
-    finish_G[0] = 0;
-    finish_G[1] = 23;
-    finish_G[2] = 23 + finish_G[1];
-    finish_G[3] = 23 + finish_G[2];
-    finish_G[4] = 23 + finish_G[3];
-    finish_G[5] = 23 + finish_G[4];
     int true_G = global::G + global::g[(global::timestamp - 1) / 1800 + 1];
-    for (auto& [obj_id, object] : global::objects) {
-        int predict_time = 105;      // 需要被丢掉的预测时间
-        int used_time = 0x3f3f3f3f;  // 读取该物品所需要的最小时间
-        for (int i = 0; i < 3; i++) {
-            Disk& disk = global::disks[object.disk_id[i]];
-            int disk_used_time = 0x3f3f3f3f;
-            if (disk.slice_id[disk.head[0]] == object.slice_id[i]) {
-                disk_used_time = 0;
-            } else if (disk.slice_id[disk.head[1]] == object.slice_id[i]) {
-                disk_used_time = 0;
-            } else {
-                disk_used_time = 1 + (finish_G[object.size] + true_G - 1 + object.max_pos[i] -
-                                      disk.slice_start[object.slice_id[i]]) /
-                                      true_G;
-            }
-            double opt = 1.0 * (give_up_16[object.tag] - lst_give_up_16[object.tag]) /
-                         global::fre_read[object.tag][(global::timestamp + 1799) / 1800];
-            if (opt > 0.01) disk_used_time = 105;
-            used_time = std::min(used_time, disk_used_time);
+    // 放弃率过高的 tag 放弃全部请求
+    for (int tag = 1; tag <= global::M; tag++) {
+        if (tag_pending_objects[tag].empty() || !is_give_up_tag(tag)) continue;
+        std::vector<int> object_ids(tag_pending_objects[tag].begin(), tag_pending_objects[tag].end());
+        for (int object_id : object_ids) {
+            Object& object = global::objects[object_id];
+            check_timeout(object, true_G, timeout_read_requests);
+            schedule_next_timeout_check(object);
         }
-        predict_time -= used_time;
-        auto temp_timeout_read_requests = object.get_timeout_requests(global::timestamp, predict_time);
-        for (auto req_id : temp_timeout_read_requests) {
-            timeout_read_requests.push_back(req_id);
-            give_up_16[object.tag]++;
-            give_up_request(req_id);
+    }
+    // 时间轮中这个时间片需要检查的对象
+    std::vector<int> object_ids;
+    std::swap(object_ids, timeout_wheel[global::timestamp % TIMEOUT_WHEEL_SIZE]);
+    for (int object_id : object_ids) {
+        auto it = global::objects.find(object_id);
+        if (it == global::objects.end() || it->second.timeout_check_time != global::timestamp) {
+            continue;
         }
+        check_timeout(it->second, true_G, timeout_read_requests);
+        schedule_next_timeout_check(it->second);
     }
     ed = 1.0 * std::clock() / CLOCKS_PER_SEC;
     time_timeout += ed - st;
@@ -899,15 +1648,219 @@ inline std::vector<std::vector<std::pair<int, int>>> garbage_collection_function
     }
     return garbage_collection_strategies;
 }
+// -------------------------读取请求准入-------------------------
+// 根据请求到达时副本所在 slice 的排名估计它被完成的概率：两个磁头按照收益从高到低扫描 slice，
+// 排在前面的 slice 都扫完之后才会轮到这个 slice，等待的 token 数除以磁头的 token 数就是等待的时间片数
+// 放弃率过高的 tag 的请求在这个时间片结束时就会被放弃，只有 1 个时间片的期限
+// 完成概率很低的请求直接放弃，不浪费读取它们的 token
+
+constexpr double ADMISSION_SCALE = 1.0 / 7;     // 等待时间估计的误差和期限的比例
+constexpr double ADMISSION_THRESHOLD = 0.05;    // 完成概率低于这个值的请求直接放弃
+constexpr int CALIBRATION_BINS = 10;            // 按照预测的完成概率分桶统计实际的完成率
+constexpr int ADMISSION_EXPLORE_INTERVAL = 20;  // 完成概率低于阈值的请求中，每这么多个仍然接受一个，统计它们实际的完成率
+
+// 一个硬盘上 slice 按照收益的降序排名，在时间片之间保留
+// 只重新计算版本号变化了的 slice，排序从上一个时间片的顺序开始插入排序，收益的相对顺序通常只有少量变化
+class SliceRanking {
+   public:
+    void init(int slice_num) {
+        order_.resize(slice_num);
+        std::iota(order_.begin(), order_.end(), 1);
+        gain_.assign(slice_num + 1, 0);
+        gain_version_.assign(slice_num + 1, -1);
+        sweep_cost_.assign(slice_num + 1, 0);
+        request_version_.assign(slice_num + 1, -1);
+        wait_time_.assign(slice_num + 1, 0);
+    }
+
+    void update(const Disk& disk, int true_G) {
+        bool changed = true_G != true_G_;
+        true_G_ = true_G;
+        for (int head_id = 0; head_id < 2; head_id++) {
+            int head_slice = disk.slice_id[disk.head[head_id]];
+            changed |= head_slice_[head_id] != head_slice;
+            head_slice_[head_id] = head_slice;
+        }
+        for (int j = 1; j <= disk.slice_num; j++) {
+            if (gain_version_[j] != disk.slice_gain_version[j]) {
+                gain_version_[j] = disk.slice_gain_version[j];
+                double gain = disk.get_slice_gain(j);
+                changed |= gain != gain_[j];
+                gain_[j] = gain;
+            }
+            if (request_version_[j] != disk.slice_request_version[j]) {
+                request_version_[j] = disk.slice_request_version[j];
+                int sweep_cost = disk.get_slice_sweep_cost(j);
+                changed |= sweep_cost != sweep_cost_[j];
+                sweep_cost_[j] = sweep_cost;
+            }
+        }
+        if (!changed) return;
+        // 磁头所在的 slice 正在被扫描，排在最前面
+        auto before = [&](int a, int b) {
+            double gain_a = a == head_slice_[0] || a == head_slice_[1] ? std::numeric_limits<double>::max() : gain_[a];
+            double gain_b = b == head_slice_[0] || b == head_slice_[1] ? std::numeric_limits<double>::max() : gain_[b];
+            return gain_a != gain_b ? gain_a > gain_b : a > b;
+        };
+        for (int k = 1; k < (int)order_.size(); k++) {
+            int slice_id = order_[k], p = k;
+            for (; p > 0 && before(slice_id, order_[p - 1]); p--) {
+                order_[p] = order_[p - 1];
+            }
+            order_[p] = slice_id;
+        }
+        long long ahead_cost = 0;
+        for (int k = 0; k < (int)order_.size(); k++) {
+            int slice_id = order_[k];
+            // 前两个 slice 各自有一个磁头，之后的 slice 等待前面的 slice 被两个磁头分摊扫完
+            wait_time_[slice_id] = k < 2 ? 0 : (ahead_cost / 2.0 + sweep_cost_[slice_id]) / true_G;
+            ahead_cost += sweep_cost_[slice_id];
+        }
+    }
+
+    double wait_time(int slice_id) const { return wait_time_[slice_id]; }  // 扫描到 slice 之前需要等待的时间片数
+
+   private:
+    std::vector<int> order_;            // 排名为 k + 1 的 slice
+    std::vector<double> gain_;          // slice 的收益
+    std::vector<int> gain_version_;     // 计算收益时的 slice_gain_version
+    std::vector<int> sweep_cost_;       // 扫描 slice 中全部请求的 token 数
+    std::vector<int> request_version_;  // 计算 sweep_cost 时的 slice_request_version
+    std::vector<double> wait_time_;
+    std::array<int, 2> head_slice_{};
+    int true_G_ = 0;
+};
+
+class AdmissionModel {
+   public:
+    // 每个时间片读取请求到达之前调用，更新每个硬盘的 slice 排名
+    void update() {
+        int true_G = global::G + global::g[(global::timestamp - 1) / 1800 + 1];
+        if (rankings_.empty()) {
+            rankings_.resize(global::N + 1);
+            for (int i = 1; i <= global::N; i++) {
+                rankings_[i].init(global::disks[i].slice_num);
+            }
+        }
+        for (int i = 1; i <= global::N; i++) {
+            rankings_[i].update(global::disks[i], true_G);
+        }
+    }
+
+    // 至少一个副本在期限之前被扫描到的概率
+    double completion_probability(const Object& object) const {
+        double deadline = is_give_up_tag(object.tag) ? 1 : 105;
+        double miss = 1;
+        for (int i = 0; i < 3; i++) {
+            double wait = rankings_[object.disk_id[i]].wait_time(object.slice_id[i]);
+            miss *= 1 - 1 / (1 + std::exp((wait - deadline) / (deadline * ADMISSION_SCALE)));
+        }
+        return 1 - miss;
+    }
+
+    bool admit(int req_id, const Object& object) {
+        double probability = completion_probability(object);
+        int bin = std::min((int)(probability * CALIBRATION_BINS), CALIBRATION_BINS - 1);
+        if (probability < ADMISSION_THRESHOLD) {
+            // 只统计被接受的请求时，校准结果会受到自己的放弃决策影响，因此抽样接受一部分应该放弃的请求
+            if (++below_threshold_num_ % ADMISSION_EXPLORE_INTERVAL != 0) {
+                rejected_num_++;
+                return false;
+            }
+            bin = EXPLORE_BIN;
+        }
+        predictions_[req_id] = {bin, probability};
+        return true;
+    }
+
+    // 请求完成、超时或者被删除时记录实际的结果，被删除的请求不计入统计
+    void complete(int req_id) { record(req_id, true); }
+    void give_up(int req_id) { record(req_id, false); }
+    void forget(int req_id) { predictions_.erase(req_id); }
+
+    void print_calibration() const {
+        std::cerr << "admission rejected: " << rejected_num_ << '\n';
+        for (int bin = 0; bin < CALIBRATION_BINS; bin++) {
+            const auto& stat = calibration_[bin];
+            if (stat.count == 0) continue;
+            std::cerr << "admission bin [" << 1.0 * bin / CALIBRATION_BINS << ", " << 1.0 * (bin + 1) / CALIBRATION_BINS
+                      << "): count " << stat.count << ", predicted " << stat.predicted / stat.count << ", completed "
+                      << 1.0 * stat.completed / stat.count << '\n';
+        }
+        const auto& stat = calibration_[EXPLORE_BIN];
+        if (stat.count != 0) {
+            std::cerr << "admission explored below " << ADMISSION_THRESHOLD << ": count " << stat.count << ", predicted "
+                      << stat.predicted / stat.count << ", completed " << 1.0 * stat.completed / stat.count << '\n';
+        }
+    }
+
+   private:
+    struct CalibrationStat {
+        long long count = 0;
+        long long completed = 0;
+        double predicted = 0;
+    };
+
+    void record(int req_id, bool completed) {
+        auto it = predictions_.find(req_id);
+        if (it == predictions_.end()) return;
+        auto& stat = calibration_[it->second.first];
+        stat.count++;
+        stat.completed += completed;
+        stat.predicted += it->second.second;
+        predictions_.erase(it);
+    }
+
+    static constexpr int EXPLORE_BIN = CALIBRATION_BINS;  // 抽样接受的低于阈值的请求单独统计
+
+    std::vector<SliceRanking> rankings_;                             // 每个硬盘的 slice 排名
+    HashTable<int, std::pair<int, double>> predictions_;             // (req_id, (bin, 预测的完成概率))
+    std::array<CalibrationStat, CALIBRATION_BINS + 1> calibration_;  // 每个桶的统计
+    long long rejected_num_ = 0;
+    long long below_threshold_num_ = 0;  // 完成概率低于阈值的请求数量
+};
+
+inline AdmissionModel admission_model;
+
+// -------------------------预测范围-------------------------
+// 硬盘只统计等待时间不超过 predict_time 的请求的收益
+// 完成的请求的等待时间几乎都在分布的 HORIZON_QUANTILE 分位数之内，更老的请求大概率会超时，不应该再把磁头吸引过去
+
+constexpr int HORIZON_UPDATE_INTERVAL = 100;      // 每隔多少个时间片调整一次
+constexpr double HORIZON_QUANTILE = 0.99;         // 完成时间的分位数
+constexpr int HORIZON_MARGIN = 20;                // 在分位数之外多保留的时间片
+constexpr int MIN_HORIZON = 70;                   // predict_time 的下限
+constexpr long long HORIZON_MIN_SAMPLES = 1000;   // 样本太少时不调整
+
+inline void update_predict_horizon(Disk& disk) {
+    auto& latency = disk.completion_latency;
+    long long total = std::accumulate(latency.begin(), latency.end(), 0LL);
+    if (total < HORIZON_MIN_SAMPLES) {
+        return;
+    }
+    long long need = (long long)std::ceil(total * HORIZON_QUANTILE);
+    int quantile = 0;
+    for (long long count = latency[0]; count < need; count += latency[++quantile]) {
+    }
+    disk.set_predict_time(std::clamp(quantile + HORIZON_MARGIN, MIN_HORIZON, 105));
+    // 旧的样本逐渐衰减，跟上负载的变化
+    for (auto& count : latency) {
+        count /= 2;
+    }
+}
+
 // ---------------交互----------------
 // 应该是不需要修改
 std::map<std::pair<int, int>, bool> should_throw;
 inline void run() {
     io::init_input();
+    io::start_input_thread();
     init_local();
     io::init_output();
     give_up_16.resize(global::M + 1);
     lst_give_up_16.resize(global::M + 1);
+    speculative_plans.resize(global::N + 1);
+    tag_pending_objects.resize(global::M + 1);
     int busy_request_num = 0, done_request_num = 0;  // 一个统计有多少查询被busy,完成了多少的变量。
     for (global::timestamp = 1; global::timestamp <= global::T + 105; global::timestamp++) {
         // debug
@@ -917,16 +1870,20 @@ inline void run() {
         // }
         // 时间片交互事件
         io::timestamp_align(global::timestamp);
+        auto critical_st = std::chrono::steady_clock::now();
 
         // 对象删除事件
         auto deleted_objects = io::delete_object_input();
+        finish_speculation();
         deleted_requests.clear();
+        double del_st = 1.0 * std::clock() / CLOCKS_PER_SEC;
         for (int object_id : deleted_objects) {
-            double del_st = 1.0 * std::clock() / CLOCKS_PER_SEC;
-            delete_object(object_id);
-            double del_ed = 1.0 * std::clock() / CLOCKS_PER_SEC;
-            time_del += del_ed - del_st;
+            tag_pending_objects[global::objects[object_id].tag].erase(object_id);
         }
+        delete_objects(deleted_objects);
+        double del_ed = 1.0 * std::clock() / CLOCKS_PER_SEC;
+        time_del += del_ed - del_st;
+        for (int req_id : deleted_requests) admission_model.forget(req_id);
         io::delete_object_output(deleted_requests);
 
         // 对象写入事件
@@ -939,59 +1896,17 @@ inline void run() {
         io::write_object_output(write_strategies);
 
         // 对象读取事件
-        std::vector<int> pre_busy;  // 根据超时率扔掉一堆玩意
+        std::vector<int> pre_busy;  // 完成概率太低，直接放弃的请求
         auto read_objects = io::read_object_input();
-        std::vector<std::vector<double>> disk_slice_gain(global::N + 1,
-                                                         std::vector<double>(global::disks[0].slice_num + 1));
-        std::vector<std::vector<int>> disk_slice_gain_order(global::N + 1,
-                                                            std::vector<int>(global::disks[0].slice_num + 1));
-        // 计算slice的gain,来给slice排序,方便丢request
-        for (int i = 1; i <= global::N; ++i) {
-            for (int j = 1; j <= global::disks[0].slice_num; ++j) {
-                disk_slice_gain[i][j] = global::disks[i].get_slice_gain(j);
-            }
-            Disk& disk = global::disks[i];
-            disk_slice_gain[i][disk.slice_id[disk.head[0]]] = std::numeric_limits<double>::max();
-            disk_slice_gain[i][disk.slice_id[disk.head[1]]] = std::numeric_limits<double>::max();
-            std::vector<std::pair<double, int>> slice_gain_with_index;
-            for (int j = 1; j <= global::disks[0].slice_num; ++j) {
-                slice_gain_with_index.push_back({disk_slice_gain[i][j], j});
-            }
-            // 按照 slice_gain 降序排序
-            std::sort(slice_gain_with_index.begin(), slice_gain_with_index.end(),
-                      [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
-                          return a.first > b.first;  // 降序
-                      });
-
-            // 计算每个 slice 的排名
-            for (int j = 0; j < global::disks[0].slice_num; ++j) {
-                disk_slice_gain_order[i][slice_gain_with_index[j].second] = j + 1;
-            }
-        }
+        admission_model.update();
         for (const auto& [req_id, object_id] : read_objects) {
             Object& object = global::objects[object_id];
-            bool flag = 1;
-            // opt超时率
-            double opt = 1.0 * (give_up_16[object.tag] - lst_give_up_16[object.tag]) /
-                         global::fre_read[object.tag][(global::timestamp + 1799) / 1800];
-            int pos1 = disk_slice_gain_order[object.disk_id[0]][object.slice_id[0]],
-                pos2 = disk_slice_gain_order[object.disk_id[1]][object.slice_id[1]],
-                pos3 = disk_slice_gain_order[object.disk_id[2]][object.slice_id[2]];
-            if (opt > 0.02 && global::rng() % 100 > 1.0 / opt &&
-                std::min({pos1, pos2, pos3}) > 2) {  // 这里分析数据来的.jpg
-                pre_busy.push_back(req_id);
-                flag = 0;
-            }
-            /*if (should_throw[{object.tag, (global::timestamp + 1799) / 1800}] == 1) {
+            if (!admission_model.admit(req_id, object)) {
                 pre_busy.push_back(req_id);
-                flag = 0;
-            }*/
-            if (flag) {
+            } else {
                 object.add_request(req_id, global::timestamp);
-                for (int i = 0; i < 3; i++) {
-                    Disk& disk = global::disks[object.disk_id[i]];
-                    disk.query(object, req_id);
-                }
+                assign_request(object, req_id);
+                track_request_timeout(object);
                 global::request_object_id[req_id] = object_id;
             }
         }
@@ -1002,15 +1917,21 @@ inline void run() {
         double read_ed = 1.0 * std::clock() / CLOCKS_PER_SEC;
         time_read += read_ed - read_st;
         io::read_object_output(head_strategies, completed_requests);
+        for (int req_id : completed_requests) admission_model.complete(req_id);
         done_request_num += completed_requests.size();
         // 获取放弃/超时的读取请求
         auto timeout_read_requests = timeout_read_requests_function();
+        for (int req_id : timeout_read_requests) admission_model.give_up(req_id);
         for (auto v : pre_busy) timeout_read_requests.push_back(v);
         busy_request_num += (int)timeout_read_requests.size();
         io::busy_requests_output(timeout_read_requests);
+        time_critical += std::chrono::duration<double>(std::chrono::steady_clock::now() - critical_st).count();
         // 一轮结束，更新磁盘的状态
         for (int i = 1; i <= global::N; ++i) {
             double st = 1.0 * std::clock() / CLOCKS_PER_SEC;
+            if (global::timestamp % HORIZON_UPDATE_INTERVAL == 0) {
+                update_predict_horizon(global::disks[i]);
+            }
             auto timeout_requests = global::disks[i].next_time();
             double ed = 1.0 * std::clock() / CLOCKS_PER_SEC;
             time_update += ed - st;
@@ -1020,6 +1941,11 @@ inline void run() {
         if (global::timestamp % 1800 == 0) {
             std::cerr << global::timestamp << " total busy:" << busy_request_num << ",total done: " << done_request_num
                       << '\n';
+            std::cerr << "predict_time:";
+            for (int i = 1; i <= global::N; ++i) {
+                std::cerr << " " << global::disks[i].predict_time;
+            }
+            std::cerr << '\n';
 
             for (int i = 1; i <= global::M; ++i) {
                 std::cerr << "id " << i << " "
@@ -1036,21 +1962,36 @@ inline void run() {
             auto garbage_collection_strategies = garbage_collection_function();
             io::garbage_collection_output(garbage_collection_strategies);
 
-            // 维护 object 的 max_pos
+            // 维护 object 的 min_pos 和 max_pos，slice_unclean_objects 以 min_pos 为键，需要一起更新
             for (auto& [obj_id, object] : global::objects) {
                 for (int i = 0; i < 3; i++) {
+                    Disk& disk = global::disks[object.disk_id[i]];
+                    auto& unclean_objects = disk.slice_unclean_objects[object.slice_id[i]];
+                    bool tracked = unclean_objects.erase({object.min_pos[i], obj_id}) != 0;
+                    object.min_pos[i] = *std::min_element(object.block_id[i].begin() + 1, object.block_id[i].end());
+                    if (tracked) {
+                        unclean_objects.insert({object.min_pos[i], obj_id});
+                    }
                     object.max_pos[i] = *std::max_element(object.block_id[i].begin() + 1, object.block_id[i].end());
                 }
             }
             // io::garbage_collection_output(std::vector<std::vector<std::pair<int, int>>>(global::N + 1));
         }
+        if (global::timestamp < global::T + 105) {
+            start_speculation(global::timestamp + 1);
+        }
     }
+    speculation_worker.stop();
+    io::stop_input_thread();
     std::cerr << "final total busy:" << " " << busy_request_num << ",total done: " << done_request_num << '\n';
     std::cerr << "total timeout time: " << time_timeout << '\n';
     std::cerr << "total read time: " << time_read << '\n';
     std::cerr << "total del time: " << time_del << '\n';
     std::cerr << "total write time: " << time_write << '\n';
     std::cerr << "total update time: " << time_update << '\n';
+    std::cerr << "total critical path time: " << time_critical << '\n';
+    admission_model.print_calibration();
+    std::cerr << "speculative plan hit: " << speculative_plan_hit << ", miss: " << speculative_plan_miss << '\n';
     std::cerr.flush();
     /*for (auto [x, w] : should_throw) {
         std::cerr << "should_throw[{" << x.first << ", " << x.second << "}] = " << w << ";\n";
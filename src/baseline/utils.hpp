@@ -25,30 +25,6 @@ inline int move_head(int disk_id, int slice_id, int p, int step) {
 inline std::vector<int> deleted_requests;
 inline std::vector<int> completed_requests;
 
-inline void clean_gain_after_head(Disk& disk, int head) {
-    for (int pos = head; pos <= disk.slice_end[disk.slice_id[head]]; pos++) {
-        ObjectBlock& block = disk.blocks[pos];
-        if (block.object_id == 0 || disk.request_num[pos] == 0) continue;
-        Object& object = global::objects[block.object_id];
-        // 如果该 object 在这个硬盘上的所有 block 都在 after_head 往后，清除（包揽）这个物品的查询贡献
-        bool should_clean_object = true;
-        int copy_id = disk.get_copy_id(object);
-        for (int i = 1; i <= object.size; i++) {
-            if (object.block_id[copy_id][i] < head) {
-                should_clean_object = false;
-                break;
-            }
-        }
-        if (!should_clean_object) continue;
-        // 清理 gain
-        for (int i = 0; i < 3; i++) {
-            Disk& disk = global::disks[object.disk_id[i]];
-            disk.clean_object_gain(object);
-        }
-        object.clean_gain();
-    }
-}
-
 inline void give_up_request(int req_id) {
     assert(global::request_object_id.find(req_id) != global::request_object_id.end());
     int object_id = global::request_object_id[req_id];
@@ -80,14 +56,16 @@ inline void swap_block(Disk& disk, int block_id1, int block_id2) {
     // 维护 disk 的状态
     std::swap(disk.blocks[block_id1], disk.blocks[block_id2]);
     std::swap(disk.request_num[block_id1], disk.request_num[block_id2]);
+    disk.update_request_index(block_id1);
+    disk.update_request_index(block_id2);
     if ((disk.blocks[block_id1].object_id == 0) != (disk.blocks[block_id2].object_id == 0)) {
-        // 交换了一个空块和一个非空块
+        // 交换了一个空块和一个非空块，交换后非空的块被写入，空的块被释放
         if (disk.blocks[block_id1].object_id != 0) {
-            disk.empty_ranges.erase(block_id1);
-            disk.empty_ranges.write(block_id2);
-        } else {
-            disk.empty_ranges.erase(block_id2);
             disk.empty_ranges.write(block_id1);
+            disk.empty_ranges.erase(block_id2);
+        } else {
+            disk.empty_ranges.write(block_id2);
+            disk.empty_ranges.erase(block_id1);
         }
     }
 }
@@ -95,24 +73,31 @@ inline void swap_block(int disk_id, int block_id1, int block_id2) {
     swap_block(global::disks[disk_id], block_id1, block_id2);
 }
 
-inline void delete_object(int object_id) {
-    assert(global::objects.find(object_id) != global::objects.end());
-
-    // 清理硬盘上的数据
-    Object& object = global::objects[object_id];
-    for (int i = 0; i < 3; i++) {
-        Disk& disk = global::disks[object.disk_id[i]];
-        disk.erase(object);
+// 批量删除一个时间片的对象：先逐个释放查询，再把每个硬盘上要释放的块按照块号排序，按 slice 顺序一次释放
+inline void delete_objects(const std::vector<int>& object_ids) {
+    std::vector<std::vector<int>> disk_blocks(global::N + 1);
+    for (int object_id : object_ids) {
+        assert(global::objects.find(object_id) != global::objects.end());
+        Object& object = global::objects[object_id];
+        for (int i = 0; i < 3; i++) {
+            Disk& disk = global::disks[object.disk_id[i]];
+            disk.erase_requests(object);
+            disk_blocks[object.disk_id[i]].insert(disk_blocks[object.disk_id[i]].end(), object.block_id[i].begin() + 1,
+                                                  object.block_id[i].end());
+        }
+        for (const auto& [req_id, request] : object.read_requests) {
+            global::request_object_id.erase(req_id);
+            deleted_requests.push_back(req_id);
+        }
     }
-
-    std::vector<int> temp_deleted_requests;
-    for (const auto& [req_id, request] : object.read_requests) {
-        global::request_object_id.erase(req_id);
-        temp_deleted_requests.push_back(req_id);
+    for (int disk_id = 1; disk_id <= global::N; disk_id++) {
+        if (disk_blocks[disk_id].empty()) continue;
+        std::sort(disk_blocks[disk_id].begin(), disk_blocks[disk_id].end());
+        global::disks[disk_id].erase_blocks(disk_blocks[disk_id]);
+    }
+    for (int object_id : object_ids) {
+        global::objects.erase(object_id);
     }
-    deleted_requests.insert(deleted_requests.end(), temp_deleted_requests.begin(), temp_deleted_requests.end());
-
-    global::objects.erase(object_id);
 }
 
 inline void write_object(const ObjectWriteStrategy& strategy) {
@@ -129,14 +114,14 @@ inline void simulate_head(Disk& disk, int head_id, const HeadStrategy& strategy)
         switch (action.type) {
             case HeadActionType::JUMP: {
                 disk.pre_action[head_id] = HeadActionType::JUMP;
-                disk.pre_action_cost[head_id] = global::G;
+                disk.pre_action_cost[head_id] = TokenCost::jump_cost(global::G);
                 disk.head[head_id] = action.target;
                 break;
             }
             case HeadActionType::READ: {
                 auto cost = disk.pre_action[head_id] != HeadActionType::READ
-                                ? 64
-                                : std::max(16, (disk.pre_action_cost[head_id] * 4 + 4) / 5);
+                                ? TokenCost::READ_COST[1]
+                                : TokenCost::next_read_cost(disk.pre_action_cost[head_id]);
                 disk.pre_action[head_id] = HeadActionType::READ;
                 disk.pre_action_cost[head_id] = cost;
 
@@ -156,6 +141,8 @@ inline void simulate_head(Disk& disk, int head_id, const HeadStrategy& strategy)
                     t_disk.read(object.block_id[i][block.object_block_index]);
                 }
                 for (int request_id : temp_completed_requests) {
+                    // 等待时间只计入完成这个请求的硬盘
+                    disk.record_completion(global::timestamp - object.read_requests.at(request_id).timestamp);
                     for (int i = 0; i < 3; i++) {
                         Disk& t_disk = global::disks[object.disk_id[i]];
                         t_disk.erase_request(object, request_id);
@@ -167,7 +154,7 @@ inline void simulate_head(Disk& disk, int head_id, const HeadStrategy& strategy)
             }
             case HeadActionType::PASS: {
                 disk.pre_action[head_id] = HeadActionType::PASS;
-                disk.pre_action_cost[head_id] = 1;
+                disk.pre_action_cost[head_id] = TokenCost::PASS_COST;
                 disk.head[head_id] = mod(disk.head[head_id], 1, global::V, 1);
                 break;
             }
@@ -1,7 +1,13 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
 #include <vector>
 
 #include "global.hpp"
@@ -39,29 +45,229 @@ inline void init_input() {
     }
 }
 
+// -------------------------输入线程-------------------------
+// init_input 之后的输入全部由输入线程解析：按照交互的顺序把每个阶段的输入解析成事件，通过单生产者单消费者的环形队列交给主线程
+// 主线程的输入函数只从队列中取事件，因此事件的顺序就是交互的阶段顺序
+
+enum class InputEventType {
+    TIMESTAMP,           // values = {timestamp}
+    DELETE,              // values = {object_id...}
+    WRITE,               // values = {id, size, tag, ...}
+    READ,                // values = {req_id, object_id, ...}
+    GARBAGE_COLLECTION,  // values 为空
+};
+
+struct InputEvent {
+    InputEventType type;
+    std::vector<int> values;
+};
+
+// 单生产者单消费者环形队列，槽位预先分配，vector 的容量在复用时保留
+// 等待时先自旋一小段时间，之后阻塞在条件变量上，评测程序计算的时候不占用 CPU
+// 等待的一方先设置 waiting 再检查下标，另一方先修改下标再检查 waiting（都是 seq_cst），不会丢失唤醒
+template <typename T, size_t Capacity>
+class SpscRing {
+   public:
+    static constexpr int SPIN_COUNT = 64;  // 阻塞之前 yield 的次数
+
+    // 生产者：等待一个空闲的槽位，填写完之后调用 push
+    T& back() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        wait_until(producer_waiting_, [&] { return tail - head_.load() != Capacity; });
+        return slots_[tail % Capacity];
+    }
+    void push() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1);
+        wake(consumer_waiting_);
+    }
+
+    // 消费者：等待下一个事件，使用完之后调用 pop
+    T& front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        wait_until(consumer_waiting_, [&] { return tail_.load() != head; });
+        return slots_[head % Capacity];
+    }
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1);
+        wake(producer_waiting_);
+    }
+
+   private:
+    template <typename Ready>
+    void wait_until(std::atomic<bool>& waiting, Ready ready) {
+        for (int i = 0; i < SPIN_COUNT; i++) {
+            if (ready()) return;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting.store(true);
+        cv_.wait(lock, ready);
+        waiting.store(false);
+    }
+
+    void wake(std::atomic<bool>& waiting) {
+        if (waiting.load()) {
+            // 加锁保证对方已经进入等待，或者还没有检查下标
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    std::array<T, Capacity> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::atomic<bool> producer_waiting_{false};
+    std::atomic<bool> consumer_waiting_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+inline SpscRing<InputEvent, 64> input_events;
+inline std::thread input_thread;
+
+// 直接从 std::cin 的缓冲区读取，init_input 中已经缓冲但还没有解析的输入不会丢失
+class InputScanner {
+   public:
+    explicit InputScanner(std::streambuf* buf) : buf_(buf) {}
+
+    // 读取一个非负整数，输入结束时返回 0
+    int read_int() {
+        int c = buf_->sbumpc();
+        while (c != EOF && (c < '0' || c > '9')) {
+            c = buf_->sbumpc();
+        }
+        int x = 0;
+        while (c >= '0' && c <= '9') {
+            x = x * 10 + (c - '0');
+            c = buf_->sbumpc();
+        }
+        return x;
+    }
+
+    // 跳过一个单词
+    void skip_word() {
+        int c = buf_->sbumpc();
+        while (c == ' ' || c == '\n' || c == '\r') {
+            c = buf_->sbumpc();
+        }
+        while (c != EOF && c != ' ' && c != '\n' && c != '\r') {
+            c = buf_->sbumpc();
+        }
+    }
+
+   private:
+    std::streambuf* buf_;
+};
+
+// 按照交互的阶段顺序每次解析一个事件：TIMESTAMP、删除、写入、读取，每 1800 个时间片之后还有垃圾回收
+class InputProducer {
+   public:
+    InputProducer() : scanner_(std::cin.rdbuf()) {}
+
+    bool done() const { return timestamp_ > global::T + 105; }
+
+    void produce() {
+        InputEvent& event = input_events.back();
+        event.values.clear();
+        switch (phase_) {
+            case 0:
+                scanner_.skip_word();
+                event.type = InputEventType::TIMESTAMP;
+                event.values.push_back(scanner_.read_int());
+                break;
+            case 1:
+                event.type = InputEventType::DELETE;
+                read_values(event, 1);
+                break;
+            case 2:
+                event.type = InputEventType::WRITE;
+                read_values(event, 3);
+                break;
+            case 3:
+                event.type = InputEventType::READ;
+                read_values(event, 2);
+                break;
+            case 4:
+                scanner_.skip_word();
+                scanner_.skip_word();
+                event.type = InputEventType::GARBAGE_COLLECTION;
+                break;
+        }
+        input_events.push();
+        phase_++;
+        if (phase_ == 5 || (phase_ == 4 && timestamp_ % 1800 != 0)) {
+            phase_ = 0;
+            timestamp_++;
+        }
+    }
+
+   private:
+    void read_values(InputEvent& event, int values_per_item) {
+        int n = scanner_.read_int();
+        for (int i = 0; i < n * values_per_item; i++) {
+            event.values.push_back(scanner_.read_int());
+        }
+    }
+
+    InputScanner scanner_;
+    int timestamp_ = 1;
+    int phase_ = 0;
+};
+
+inline InputProducer* input_producer;
+inline bool input_threaded;
+
+// 在 init_input 之后调用
+// 只有一个核时，输入线程等待事件时的空转会和评测程序抢占时间，此时在主线程中按需解析
+inline void start_input_thread() {
+    static InputProducer producer;
+    input_producer = &producer;
+    input_threaded = std::thread::hardware_concurrency() > 1;
+    if (input_threaded) {
+        input_thread = std::thread([] {
+            while (!input_producer->done()) {
+                input_producer->produce();
+            }
+        });
+    }
+}
+
+inline void stop_input_thread() {
+    if (input_thread.joinable()) {
+        input_thread.join();
+    }
+}
+
+// 等待下一个事件，没有输入线程时由主线程解析
+inline InputEvent& next_input_event() {
+    if (!input_threaded) {
+        input_producer->produce();
+    }
+    return input_events.front();
+}
+
+// 取出下一个事件的数据
+inline std::vector<int> pop_input_event([[maybe_unused]] InputEventType type) {
+    InputEvent& event = next_input_event();
+    assert(event.type == type);
+    std::vector<int> values = event.values;
+    input_events.pop();
+    return values;
+}
+
 inline void init_output() {
     std::cout << "OK" << '\n';
     std::cout.flush();
 }
 
-inline void timestamp_align(int timestamp) {
-    std::string event;
-    int time;
-    std::cin >> event >> time;
+inline void timestamp_align([[maybe_unused]] int timestamp) {
+    int time = pop_input_event(InputEventType::TIMESTAMP)[0];
     assert(time == timestamp);
-    std::cout << event << " " << timestamp << '\n';
+    std::cout << "TIMESTAMP " << time << '\n';
     std::cout.flush();
 }
 
-inline std::vector<int> delete_object_input() {
-    int n_delete;
-    std::cin >> n_delete;
-    std::vector<int> deleted_requests(n_delete);
-    for (int i = 0; i < n_delete; i++) {
-        std::cin >> deleted_requests[i];
-    }
-    return deleted_requests;
-}
+inline std::vector<int> delete_object_input() { return pop_input_event(InputEventType::DELETE); }
 
 inline void delete_object_output(const std::vector<int>& deleted_requests) {
     std::cout << deleted_requests.size() << '\n';
@@ -72,12 +278,15 @@ inline void delete_object_output(const std::vector<int>& deleted_requests) {
 }
 
 inline std::vector<ObjectWriteRequest> write_object_input() {
-    int n_write;
-    std::cin >> n_write;
-    std::vector<ObjectWriteRequest> write_objects(n_write);
-    for (int i = 0; i < n_write; i++) {
-        std::cin >> write_objects[i].id >> write_objects[i].size >> write_objects[i].tag;
+    InputEvent& event = next_input_event();
+    assert(event.type == InputEventType::WRITE);
+    std::vector<ObjectWriteRequest> write_objects(event.values.size() / 3);
+    for (int i = 0; i < (int)write_objects.size(); i++) {
+        write_objects[i].id = event.values[i * 3];
+        write_objects[i].size = event.values[i * 3 + 1];
+        write_objects[i].tag = event.values[i * 3 + 2];
     }
+    input_events.pop();
     return write_objects;
 }
 
@@ -95,12 +304,14 @@ inline void write_object_output(const std::vector<ObjectWriteStrategy>& write_st
 }
 
 inline std::vector<ObjectReadRequest> read_object_input() {
-    int n_read;
-    std::cin >> n_read;
-    std::vector<ObjectReadRequest> read_objects(n_read);
-    for (int i = 0; i < n_read; i++) {
-        std::cin >> read_objects[i].req_id >> read_objects[i].object_id;
+    InputEvent& event = next_input_event();
+    assert(event.type == InputEventType::READ);
+    std::vector<ObjectReadRequest> read_objects(event.values.size() / 2);
+    for (int i = 0; i < (int)read_objects.size(); i++) {
+        read_objects[i].req_id = event.values[i * 2];
+        read_objects[i].object_id = event.values[i * 2 + 1];
     }
+    input_events.pop();
     return read_objects;
 }
 
@@ -127,9 +338,9 @@ inline void busy_requests_output(const std::vector<int>& busy_requests) {
 }
 
 inline void garbage_collection_input() {
-    std::string str;
-    std::cin >> str;
-    std::cin >> str;
+    [[maybe_unused]] InputEvent& event = next_input_event();
+    assert(event.type == InputEventType::GARBAGE_COLLECTION);
+    input_events.pop();
 }
 
 // TODO: 临时方案
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
 #include <deque>
 #include <ext/pb_ds/assoc_container.hpp>
 #include <ext/pb_ds/hash_policy.hpp>
@@ -45,6 +46,39 @@ constexpr auto generate_simluate_mult() {
 constexpr auto GAIN_MULT = generate_gain_mult();
 constexpr auto SIMLUATE_MULT = generate_simluate_mult();
 
+// 读取请求的价值模型：价值 = age_weight(已经等待的时间片数) * size_weight(对象大小)
+// 两部分可以分开计算，因此同一个时间片到达的请求可以先把 size_weight 加起来再乘上 age_weight
+// 原本的代理模型：等待越久权重越高，大小按 size + 1 计算
+struct PendingVolumeValue {
+    static double age_weight(int age) { return SIMLUATE_MULT[age]; }
+    static double size_weight(int size) { return size + 1; }
+};
+
+// 截止时间感知的模型：请求的权重是再等待 Delay 个时间片会损失的得分，再乘上 SIMLUATE_MULT 中随等待时间增长的紧迫度
+// 刚到达的请求只会损失一点得分，临近 105 的请求会损失剩余的全部得分，超过 105 的请求没有价值
+template <int Delay>
+struct DeadlineValueModel {
+    static constexpr int DEADLINE = 105;
+
+    // 等待 age 个时间片之后完成请求的得分系数
+    static constexpr double score(int age) {
+        return age <= 10 ? 1 - 0.005 * age : age < DEADLINE ? 1.05 - 0.01 * age : 0;
+    }
+    static constexpr std::array<double, 120> generate_age_weight() {
+        std::array<double, 120> age_weight = {};
+        for (int i = 0; i < (int)age_weight.size(); i++) {
+            age_weight[i] = (score(i) - score(i + Delay)) * SIMLUATE_MULT[i];
+        }
+        return age_weight;
+    }
+    static constexpr std::array<double, 120> AGE_WEIGHT = generate_age_weight();
+
+    static double age_weight(int age) { return AGE_WEIGHT[age]; }
+    static double size_weight(int size) { return (size + 1) * 0.5; }
+};
+
+using RequestValue = DeadlineValueModel<10>;
+
 struct ObjectWriteRequest {
     int id;
     int size;
@@ -80,6 +114,7 @@ struct ObjectReadRequest {
 
 struct ObjectReadStatus {
     int req_id;
+    int timestamp;             // 请求到达的时间片
     int readed_size;
     std::vector<char> readed;  // 从 1 开始标号，0 号块不使用
 };
@@ -97,11 +132,14 @@ class Object {
     int disk_id[3];                                  // 三个副本的目标硬盘
     int slice_id[3];                                 // 三个副本的目标 slice
     std::vector<int> block_id[3];                    // 三个副本的每个块在目标硬盘上的块号，注意硬盘上的块号是从 1 开始编号的
+    int min_pos[3];                                  // 三个副本最近位置
     int max_pos[3];                                  // 三个副本最远位置
+    std::vector<int> block_copy;                     // 第 i 个分块的未完成请求被分配到的副本，-1 表示没有分配
     std::deque<ObjectReadTime> read_queue;           // 读取请求的队列，存储的是请求的编号和时间戳
     HashTable<int, ObjectReadStatus> read_requests;  // (req_id, ObjectReadRequest)
     std::vector<int> request_number;                 // 第 i 个分块上的未完成请求数量
     HashSet<int> unclean_gain_requests;              // 被清空收益的请求
+    int timeout_check_time = 0;                      // 下一次检查超时的时间片，0 表示不需要检查
    public:
     Object() = default;
     Object(ObjectWriteStrategy strategy) {
@@ -112,13 +150,15 @@ class Object {
             disk_id[i] = strategy.disk_id[i];
             slice_id[i] = strategy.slice_id[i];
             block_id[i] = strategy.block_id[i];
+            min_pos[i] = *std::min_element(block_id[i].begin() + 1, block_id[i].end());
             max_pos[i] = *std::max_element(block_id[i].begin() + 1, block_id[i].end());
         }
+        block_copy.assign(size + 1, -1);
         request_number.resize(size + 1);
     }
 
     void add_request(int req_id, int timestamp) {
-        read_requests[req_id] = ObjectReadStatus{req_id, 0, std::vector<char>(size + 1)};
+        read_requests[req_id] = ObjectReadStatus{req_id, timestamp, 0, std::vector<char>(size + 1)};
         for (int i = 1; i <= size; i++) {
             request_number[i]++;
         }
@@ -166,6 +206,9 @@ class Object {
         if (unclean_gain_requests.find(req_id) != unclean_gain_requests.end()) {
             unclean_gain_requests.erase(req_id);
         }
+        if (read_requests.empty()) {
+            std::fill(block_copy.begin(), block_copy.end(), -1);
+        }
     }
 };
 
@@ -190,6 +233,87 @@ enum class HeadActionType {
     PASS,  // 跳过
 };
 
+// 磁头动作的令牌消耗模型
+// READ 链的状态 s 表示已经连续 READ 了 s 次，0 表示上一个动作不是 READ，连续 READ 超过 CHAIN_LEN 次之后的消耗不再变化
+// 第一次 READ 消耗 FirstRead，之后每次是上一次的 DecayNum / DecayDen（向上取整），最少为 MinRead
+template <int FirstRead, int MinRead, int DecayNum, int DecayDen, int PassCost>
+struct TokenCostModel {
+    static constexpr int PASS_COST = PassCost;
+    static constexpr int MIN_READ_COST = MinRead;
+
+    // 上一次 READ 消耗 prev_cost 时，这一次 READ 的消耗
+    static constexpr int next_read_cost(int prev_cost) {
+        return std::max(MinRead, (prev_cost * DecayNum + DecayDen - 1) / DecayDen);
+    }
+
+    static constexpr int chain_len() {
+        int len = 1;
+        for (int cost = FirstRead; cost != MinRead; cost = next_read_cost(cost)) {
+            len++;
+        }
+        return len;
+    }
+    static constexpr int CHAIN_LEN = chain_len();
+    static constexpr int STATE_NUM = CHAIN_LEN + 1;
+
+    // READ_COST[s] 是第 s 次连续 READ 的消耗，READ_COST[0] 是 PASS 的消耗
+    static constexpr std::array<int, STATE_NUM> generate_read_cost() {
+        std::array<int, STATE_NUM> read_cost = {};
+        read_cost[0] = PassCost;
+        read_cost[1] = FirstRead;
+        for (int s = 2; s < STATE_NUM; s++) {
+            read_cost[s] = next_read_cost(read_cost[s - 1]);
+        }
+        return read_cost;
+    }
+    static constexpr std::array<int, STATE_NUM> READ_COST = generate_read_cost();
+
+    // CHAIN_COST[s][k] 是从状态 s 开始再连续 READ k 次（k <= CHAIN_LEN）的总消耗
+    static constexpr std::array<std::array<int, STATE_NUM>, STATE_NUM> generate_chain_cost() {
+        std::array<std::array<int, STATE_NUM>, STATE_NUM> chain_cost = {};
+        for (int s = 0; s < STATE_NUM; s++) {
+            for (int k = 1; k < STATE_NUM; k++) {
+                chain_cost[s][k] = chain_cost[s][k - 1] + READ_COST[chain_state(s, k)];
+            }
+        }
+        return chain_cost;
+    }
+
+    // 从状态 s 开始连续 READ k 次之后的状态
+    static constexpr int chain_state(int s, int k) { return std::min(s + k, CHAIN_LEN); }
+
+    // 从状态 s 开始连续 READ k 次的总消耗，k 可以超过 CHAIN_LEN
+    static constexpr int chain_cost(int s, int k) {
+        if (k < STATE_NUM) {
+            return CHAIN_COST[s][k];
+        }
+        return CHAIN_COST[s][CHAIN_LEN] + MinRead * (k - CHAIN_LEN);
+    }
+
+    // 上一次 READ 消耗 cost 时所处的状态
+    static constexpr int read_state(int cost) {
+        int s = 1;
+        while (s < CHAIN_LEN && READ_COST[s] > cost) {
+            s++;
+        }
+        return s;
+    }
+
+    // JUMP 会用掉整个时间片的令牌
+    static constexpr int jump_cost(int true_G) { return true_G; }
+
+    static const std::array<std::array<int, STATE_NUM>, STATE_NUM> CHAIN_COST;
+};
+template <int FirstRead, int MinRead, int DecayNum, int DecayDen, int PassCost>
+constexpr std::array<std::array<int, TokenCostModel<FirstRead, MinRead, DecayNum, DecayDen, PassCost>::STATE_NUM>,
+                     TokenCostModel<FirstRead, MinRead, DecayNum, DecayDen, PassCost>::STATE_NUM>
+    TokenCostModel<FirstRead, MinRead, DecayNum, DecayDen, PassCost>::CHAIN_COST =
+        TokenCostModel<FirstRead, MinRead, DecayNum, DecayDen, PassCost>::generate_chain_cost();
+
+// 赛题的令牌消耗：64, 52, 42, 34, 28, 23, 19, 16, 16, ...
+using TokenCost = TokenCostModel<64, 16, 4, 5, 1>;
+static_assert(TokenCost::CHAIN_LEN == 8 && TokenCost::CHAIN_COST[0][8] == 278, "令牌消耗模型和赛题不一致");
+
 struct HeadAction {
     HeadActionType type;
     int target;  // 跳转的目标，从 1 开始编号
@@ -226,37 +350,34 @@ class Disk {
     // 该数据结构用于维护时间片，会被用来计算 gain
     // 允许被删除的请求是不存在的
     struct TimeStruct {
-        int timestamp;          // 时间片的编号
-        HashSet<int> requests;  // 这个时间片的请求
-        size_t sum_read_size;   // 读取的大小之和
-        size_t sum_read_count;  // 读取的次数之和
+        int timestamp;                 // 时间片的编号
+        HashTable<int, int> requests;  // 这个时间片的请求 (req_id, 分配到这个硬盘上的块数)
+        double sum_size_weight;        // 请求的 size_weight 之和
 
-        void add_request(const Object& object, int req_id) {
+        void add_request(int req_id, int size) {
             assert(requests.find(req_id) == requests.end());
-            requests.insert(req_id);
-            sum_read_size += object.size;
-            sum_read_count++;
+            requests[req_id] = size;
+            sum_size_weight += RequestValue::size_weight(size);
         }
 
-        void remove_request(const Object& object, int req_id) {
+        void remove_request(int req_id) {
             // 允许被删除的请求是不存在的
-            if (requests.find(req_id) == requests.end()) {
+            auto it = requests.find(req_id);
+            if (it == requests.end()) {
                 return;
             }
-            requests.erase(req_id);
-            sum_read_size -= object.size;
-            sum_read_count--;
+            sum_size_weight -= RequestValue::size_weight(it->second);
+            requests.erase(it);
         }
 
         void clear_requests() {
             timestamp = 0;
             requests.clear();
-            sum_read_size = 0;
-            sum_read_count = 0;
+            sum_size_weight = 0;
         }
 
         double get_gain(int cur_timestamp) const {
-            return (double)SIMLUATE_MULT[cur_timestamp - timestamp] * (sum_read_size + sum_read_count);
+            return RequestValue::age_weight(cur_timestamp - timestamp) * sum_size_weight;
         }
     };
 
@@ -278,23 +399,129 @@ class Disk {
             }
         }
 
-        void erase(int index) {
-            auto it = ranges.lower_bound(Range{index, 0});
-            int r = index;
-            if (it != ranges.end() && it->l == index + 1) {
+        void erase(int index) { erase(index, index); }
+
+        // 释放 [l, r] 中的所有块，这些块之前都已经被写入，和相邻的段合并
+        void erase(int l, int r) {
+            auto it = ranges.lower_bound(Range{l, 0});
+            if (it != ranges.end() && it->l == r + 1) {
                 r = it->r;
+                it = ranges.erase(it);
             }
-            int l = index;
-            if (it != ranges.begin() && std::prev(it)->r == index - 1) {
+            if (it != ranges.begin() && std::prev(it)->r == l - 1) {
                 l = std::prev(it)->l;
-            }
-            if (l != index) {
                 ranges.erase(std::prev(it));
             }
-            if (r != index) {
-                ranges.erase(it);
+            ranges.insert(it, Range{l, r});
+        }
+    };
+
+    // 有查询的块组成的极长连续段，和未被查询的段交替出现，磁头规划时按段推进
+    struct RequestRanges : EmptyRanges {
+        RequestRanges() : EmptyRanges(0) { ranges.clear(); }
+
+        void add(int index) { erase(index); }
+        void remove(int index) { write(index); }
+
+        // 包含 index 的段，不存在时返回 Range{0, -1}
+        Range find(int index) const {
+            auto it = ranges.upper_bound(Range{index, std::numeric_limits<int>::max()});
+            if (it == ranges.begin() || std::prev(it)->r < index) {
+                return Range{0, -1};
             }
-            ranges.insert(Range{l, r});
+            return *std::prev(it);
+        }
+    };
+
+    // 两层 bitset，维护 request_num 不为 0 的块，用于快速查找前后最近的有查询的块
+    struct RequestIndex {
+        std::vector<uint64_t> bits;     // bits[i] 的第 j 位表示第 i * 64 + j 个块是否有查询
+        std::vector<uint64_t> summary;  // summary[i] 的第 j 位表示 bits[i * 64 + j] 是否不为 0
+
+        RequestIndex(int n) : bits(n / 64 + 1), summary(bits.size() / 64 + 1) {}
+
+        void set(int index) {
+            bits[index >> 6] |= 1ULL << (index & 63);
+            summary[index >> 12] |= 1ULL << ((index >> 6) & 63);
+        }
+
+        void reset(int index) {
+            bits[index >> 6] &= ~(1ULL << (index & 63));
+            if (bits[index >> 6] == 0) {
+                summary[index >> 12] &= ~(1ULL << ((index >> 6) & 63));
+            }
+        }
+
+        bool test(int index) const { return bits[index >> 6] >> (index & 63) & 1; }
+
+        // 大于等于 index 的第一个有查询的块，不存在时返回 0
+        int next(int index) const {
+            int word = index >> 6;
+            if (word >= (int)bits.size()) {
+                return 0;
+            }
+            uint64_t mask = bits[word] & (~0ULL << (index & 63));
+            if (mask != 0) {
+                return word << 6 | __builtin_ctzll(mask);
+            }
+            // 在 summary 中查找下一个不为 0 的 word
+            word++;
+            int group = word >> 6;
+            if (group >= (int)summary.size()) {
+                return 0;
+            }
+            uint64_t group_mask = (word & 63) == 0 ? summary[group] : summary[group] & (~0ULL << (word & 63));
+            while (group_mask == 0) {
+                if (++group >= (int)summary.size()) {
+                    return 0;
+                }
+                group_mask = summary[group];
+            }
+            word = group << 6 | __builtin_ctzll(group_mask);
+            return word << 6 | __builtin_ctzll(bits[word]);
+        }
+
+        // 小于等于 index 的最后一个有查询的块，不存在时返回 0
+        int prev(int index) const {
+            if (index <= 0) {
+                return 0;
+            }
+            int word = index >> 6;
+            uint64_t mask = bits[word] & (~0ULL >> (63 - (index & 63)));
+            if (mask != 0) {
+                return word << 6 | (63 - __builtin_clzll(mask));
+            }
+            if (word == 0) {
+                return 0;
+            }
+            word--;
+            int group = word >> 6;
+            uint64_t group_mask = summary[group] & (~0ULL >> (63 - (word & 63)));
+            while (group_mask == 0) {
+                if (--group < 0) {
+                    return 0;
+                }
+                group_mask = summary[group];
+            }
+            word = group << 6 | (63 - __builtin_clzll(group_mask));
+            return word << 6 | (63 - __builtin_clzll(bits[word]));
+        }
+
+        // [l, r] 中有查询的块的数量
+        int count(int l, int r) const {
+            if (l > r) {
+                return 0;
+            }
+            int lw = l >> 6, rw = r >> 6;
+            uint64_t lmask = ~0ULL << (l & 63), rmask = ~0ULL >> (63 - (r & 63));
+            if (lw == rw) {
+                return __builtin_popcountll(bits[lw] & lmask & rmask);
+            }
+            int result = __builtin_popcountll(bits[lw] & lmask) + __builtin_popcountll(bits[rw] & rmask);
+            for (int i = lw + 1; i < rw; i++) {
+                result += __builtin_popcountll(bits[i]);
+            }
+            return result;
         }
     };
 
@@ -321,14 +548,28 @@ class Disk {
     std::vector<int> slice_last_tag;                     // slice 中最后放入的物品的 tag
     std::vector<std::vector<int>> slice_tag_writed_num;  // slice 中每个 tag 的块数量
     std::vector<int> slice_request_num;                  // 每个 slice 中的查询个数
+    std::vector<int> slice_max_tag_writed_num;           // slice 中块数最多的 tag 的块数
+    int empty_slice_num;                                 // 完全空闲的 slice 数量
 
-    std::vector<int> tag_slice_num;  // 每个 tag 在该硬盘上的 slice 数量
+    std::vector<int> tag_slice_num;   // 每个 tag 在该硬盘上的 slice 数量
+    std::vector<int> tag_writed_num;  // 每个 tag 在该硬盘上的块数量
 
     // 每个 slice 中，每个时间片的请求，time_requests[0] 是最新的，time_requests[i] 是往前第 i 个时间片的请求
     std::vector<std::deque<TimeStruct>> slice_time_requests;
     HashTable<int, int> request_time;  // (req_id, timestamp)
+    std::array<long long, 106> completion_latency{};  // 在这个硬盘上完成的请求等待的时间片数的分布，用于调整 predict_time
+    // 每个 slice 中有查询并且收益还没有被清理的对象，按 (在这个硬盘上的最小块号, object_id) 排序
+    std::vector<std::set<std::pair<int, int>>> slice_unclean_objects;
+
+    EmptyRanges empty_ranges;      // 未被写入的连续块
+    RequestIndex requested;        // 有查询的块
+    RequestRanges request_ranges;  // 有查询的连续段
 
-    EmptyRanges empty_ranges;  // 未被写入的连续块
+    // 版本号用来判断缓存的结果是否过期：slice 中 requested 变化时 slice_request_version 加一，
+    // slice 的收益可能变化时 slice_gain_version 加一
+    std::vector<int> slice_request_version;
+    std::vector<int> slice_gain_version;
+    mutable std::vector<std::pair<int, double>> slice_gain_cache;  // (计算时的 slice_gain_version, 收益)
 
     Disk(int disk_id, int v, int m, int _slice_num, int predict_time = 105)
         : disk_id(disk_id),
@@ -352,10 +593,19 @@ class Disk {
           slice_last_tag(slice_num + 1),
           slice_tag_writed_num(slice_num + 1, std::vector<int>(m + 1)),
           slice_request_num(slice_num + 1),
+          slice_max_tag_writed_num(slice_num + 1),
+          empty_slice_num(slice_num),
           tag_slice_num(m + 1),
+          tag_writed_num(m + 1),
           slice_time_requests(slice_num + 1),
           request_time(),
-          empty_ranges(v) {
+          slice_unclean_objects(slice_num + 1),
+          empty_ranges(v),
+          requested(v),
+          request_ranges(),
+          slice_request_version(slice_num + 1),
+          slice_gain_version(slice_num + 1),
+          slice_gain_cache(slice_num + 1, {-1, 0}) {
         for (int i = 1; i <= v; i++) {
             slice_id[i] = (i - 1) / slice_size + 1;
             if (slice_id[i] > slice_num) {
@@ -369,7 +619,7 @@ class Disk {
         }
         for (int i = 1; i <= slice_num; i++) {
             slice_empty_block_num[i] = slice_end[i] - slice_start[i] + 1;
-            slice_time_requests[i].push_front(TimeStruct{0, {}, 0, 0});
+            slice_time_requests[i].push_front(TimeStruct{0, {}, 0});
         }
     }
 
@@ -380,6 +630,21 @@ class Disk {
     }
     bool has_tag(int tag) const { return tag_slice_num[tag] != 0; }
 
+    // 在修改 request_num[index] 之后调用，维护 requested 和 request_ranges
+    void update_request_index(int index) {
+        if ((request_num[index] != 0) == requested.test(index)) {
+            return;
+        }
+        slice_request_version[slice_id[index]]++;
+        if (request_num[index] != 0) {
+            requested.set(index);
+            request_ranges.add(index);
+        } else {
+            requested.reset(index);
+            request_ranges.remove(index);
+        }
+    }
+
     // 获取自己是 object 的第几个副本
     int get_copy_id(const Object& object) const {
         int copy_id = std::find(object.disk_id, object.disk_id + 3, disk_id) - object.disk_id;
@@ -397,68 +662,95 @@ class Disk {
             blocks[index] = ObjectBlock{object.id, object.size, object.tag, i};
             // 维护 block
             empty_block_num--;
+            empty_slice_num -= is_slice_empty(slice_id);
             slice_empty_block_num[slice_id]--;
+            empty_slice_num += is_slice_empty(slice_id);
             if (slice_tag_writed_num[slice_id][object.tag] == 0) {
                 slice_tag[slice_id] |= 1 << object.tag;
                 tag_slice_num[object.tag]++;
             }
             slice_last_tag[slice_id] = object.tag;
             slice_tag_writed_num[slice_id][object.tag]++;
+            tag_writed_num[object.tag]++;
+            slice_max_tag_writed_num[slice_id] =
+                std::max(slice_max_tag_writed_num[slice_id], slice_tag_writed_num[slice_id][object.tag]);
             // 维护 gain
             empty_ranges.write(index);
         }
     }
 
-    // 删除指定的物体
-    void erase(const Object& object) {
-        int copy_id = get_copy_id(object);
-        int slice_id = object.slice_id[copy_id];
-
-        // 释放查询
+    // 删除物体之前释放它在这个硬盘上的查询
+    void erase_requests(const Object& object) {
         for (const auto& [req_id, request] : object.read_requests) {
             erase_request(object, req_id);
         }
+        untrack_unclean_object(object);
+    }
 
-        // 释放块
-        for (int i = 1; i <= object.size; i++) {
-            int index = object.block_id[copy_id][i];
-            assert(blocks[index].object_id == object.id);
+    // 批量删除物体时释放它们的块，indices 按照块号升序，同一个 slice 的块相邻，连续的块一起维护 empty_ranges
+    void erase_blocks(const std::vector<int>& indices) {
+        for (int k = 0; k < (int)indices.size();) {
+            int end = k;
+            while (end + 1 < (int)indices.size() && indices[end + 1] == indices[end] + 1) {
+                end++;
+            }
+            for (int j = k; j <= end; j++) {
+                free_block(indices[j]);
+            }
+            empty_ranges.erase(indices[k], indices[end]);
+            k = end + 1;
+        }
+    }
 
-            empty_block_num++;
-            blocks[index] = ObjectBlock{0, 0, 0, 0};
-            slice_empty_block_num[slice_id]++;
-            slice_tag_writed_num[slice_id][object.tag]--;
-            if (slice_tag_writed_num[slice_id][object.tag] == 0) {
-                slice_tag[slice_id] &= ~(1 << object.tag);
-                tag_slice_num[object.tag]--;
-                if (slice_last_tag[slice_id] == object.tag) {
-                    slice_last_tag[slice_id] = 0;
-                }
+    // 释放一个块，不维护 empty_ranges
+    void free_block(int index) {
+        int slice = slice_id[index];
+        int tag = blocks[index].object_tag;
+        empty_block_num++;
+        blocks[index] = ObjectBlock{0, 0, 0, 0};
+        empty_slice_num -= is_slice_empty(slice);
+        slice_empty_block_num[slice]++;
+        empty_slice_num += is_slice_empty(slice);
+        tag_writed_num[tag]--;
+        if (slice_tag_writed_num[slice][tag]-- == slice_max_tag_writed_num[slice]) {
+            slice_max_tag_writed_num[slice] =
+                *std::max_element(slice_tag_writed_num[slice].begin(), slice_tag_writed_num[slice].end());
+        }
+        if (slice_tag_writed_num[slice][tag] == 0) {
+            slice_tag[slice] &= ~(1 << tag);
+            tag_slice_num[tag]--;
+            if (slice_last_tag[slice] == tag) {
+                slice_last_tag[slice] = 0;
             }
-            empty_ranges.erase(index);
         }
     }
 
+    // 请求只会被分配到一个副本上，不在这个硬盘上的请求直接忽略
     void erase_request(const Object& object, int req_id) {
-        assert(request_time.find(req_id) != request_time.end());
+        if (request_time.find(req_id) == request_time.end()) {
+            return;
+        }
         int copy_id = get_copy_id(object);
         int slice_id = object.slice_id[copy_id];
 
         // 维护 block
         const ObjectReadStatus& request = const_cast<Object&>(object).read_requests[req_id];
         for (int i = 1; i <= object.size; i++) {
-            // 如果已经被读取 or object 中已经读取完毕这个请求
-            if (request.readed[i] || object.read_requests.find(req_id) == object.read_requests.end()) {
+            // 如果已经被读取 or object 中已经读取完毕这个请求 or 这个块被分配到了其它副本
+            if (request.readed[i] || object.read_requests.find(req_id) == object.read_requests.end() ||
+                object.block_copy[i] != copy_id) {
                 continue;
             }
             int index = object.block_id[copy_id][i];
             assert(blocks[index].object_id == object.id);
             request_num[index]--;
+            update_request_index(index);
             slice_request_num[slice_id]--;
             total_request_num--;
         }
 
         // 维护 gain
+        slice_gain_version[slice_id]++;
         int timestamp = request_time[req_id];
         request_time.erase(req_id);
         int passed_time = cur_time - timestamp;
@@ -466,24 +758,52 @@ class Disk {
             return;
         }
         TimeStruct& time_struct = slice_time_requests[slice_id][passed_time];
-        time_struct.remove_request(object, req_id);
+        time_struct.remove_request(req_id);
     }
 
-    // 查询指定物品
-    void query(const Object& object, int req_id) {
+    // 查询指定物品，只有被分配到这个副本并且还没有被读取过的块会计入查询
+    // 请求被重新分配到这个硬盘时，passed_time 为请求已经等待的时间，按照原本的到达时间计入 gain
+    void query(const Object& object, int req_id, int passed_time = 0) {
         int copy_id = get_copy_id(object);
         int slice_id = object.slice_id[copy_id];
+        const ObjectReadStatus& request = object.read_requests.at(req_id);
+        int query_size = 0;
         for (int i = 1; i <= object.size; i++) {
+            if (request.readed[i] || object.block_copy[i] != copy_id) {
+                continue;
+            }
+            query_size++;
             int index = object.block_id[copy_id][i];
             assert(blocks[index].object_id == object.id);
             request_num[index]++;
+            update_request_index(index);
             slice_request_num[slice_id]++;
             total_request_num++;
         }
-        request_time[req_id] = cur_time;
-        slice_time_requests[slice_id].front().add_request(object, req_id);
+        request_time[req_id] = cur_time - passed_time;
+        slice_gain_version[slice_id]++;
+        if (passed_time < (int)slice_time_requests[slice_id].size()) {
+            slice_time_requests[slice_id][passed_time].add_request(req_id, query_size);
+        }
+        if (query_size != 0) {
+            slice_unclean_objects[slice_id].insert({object.min_pos[copy_id], object.id});
+        }
     }
 
+    // 对象的收益被清理、对象被删除或者 min_pos 改变之前调用
+    void untrack_unclean_object(const Object& object) {
+        int copy_id = get_copy_id(object);
+        slice_unclean_objects[object.slice_id[copy_id]].erase({object.min_pos[copy_id], object.id});
+    }
+
+    // 请求由这个硬盘读取最后一个块完成时调用，latency 为请求到达之后经过的时间片，到达的时间片内完成为 0
+    void record_completion(int latency) {
+        completion_latency[std::clamp(latency, 0, (int)completion_latency.size() - 1)]++;
+    }
+
+    // 只有等待时间不超过 predict_time 的请求计入收益，环形队列在之后的 next_time 中调整长度
+    void set_predict_time(int new_predict_time) { predict_time = new_predict_time; }
+
     // read 指定的 block
     void read(int block_index) {
         // 允许读取空块
@@ -491,34 +811,56 @@ class Disk {
             return;
         }
         // 清空这个位置的 request，Object 中会被标记为已经 read，因此不会二次读取
+        if (request_num[block_index] != 0) {
+            slice_gain_version[slice_id[block_index]]++;
+        }
         total_request_num -= request_num[block_index];
         slice_request_num[slice_id[block_index]] -= request_num[block_index];
         request_num[block_index] = 0;
+        update_request_index(block_index);
     }
 
-    double get_slice_gain(int slice_id) {
+    // 结果按照 slice_gain_version 缓存，版本没有变化时直接返回
+    double get_slice_gain(int slice_id) const {
+        auto& [version, gain] = slice_gain_cache[slice_id];
+        if (version == slice_gain_version[slice_id]) {
+            return gain;
+        }
+        version = slice_gain_version[slice_id];
+        gain = 0;
         if (slice_request_num[slice_id] == 0) {
-            return 0;
+            return gain;
         }
-        double gain = 0;
         for (int i = 0; i < (int)slice_time_requests[slice_id].size(); i++) {
             gain += slice_time_requests[slice_id][i].get_gain(cur_time);
         }
         return gain;
     }
 
+    // 估计一次扫完 slice 中所有查询需要的令牌：有查询的块连续 READ，其余的块 PASS
+    int get_slice_sweep_cost(int slice_id) const {
+        int first = requested.next(slice_start[slice_id]);
+        if (first == 0 || first > slice_end[slice_id]) {
+            return 0;
+        }
+        int last = requested.prev(slice_end[slice_id]);
+        int read_num = requested.count(first, last);
+        return TokenCost::chain_cost(0, read_num) + TokenCost::PASS_COST * (last - first + 1 - read_num);
+    }
+
     void clean_object_gain(Object& object) {
         int copy_id = get_copy_id(object);
         int slice_id = object.slice_id[copy_id];
+        slice_gain_version[slice_id]++;
         for (auto req_id : object.unclean_gain_requests) {
             if (request_time.find(req_id) != request_time.end()) {
                 int timestamp = request_time[req_id];
                 int passed_time = cur_time - timestamp;
-                if (passed_time > predict_time) {
+                if (passed_time >= (int)slice_time_requests[slice_id].size()) {
                     continue;
                 }
                 TimeStruct& time_struct = slice_time_requests[slice_id][passed_time];
-                time_struct.remove_request(object, req_id);
+                time_struct.remove_request(req_id);
             }
         }
     }
@@ -529,12 +871,21 @@ class Disk {
         cur_time++;
         std::vector<int> timeout_requests;
         for (int i = 1; i <= slice_num; i++) {
+            slice_gain_version[i]++;
             auto& time_requests = slice_time_requests[i];
-            time_requests.push_front(TimeStruct{cur_time, {}, 0, 0});
+            // predict_time 变小时丢掉多余的时间片
+            while ((int)time_requests.size() > predict_time + 1) {
+                for (const auto& [req_id, size] : time_requests.back().requests) {
+                    timeout_requests.push_back(req_id);
+                }
+                time_requests.pop_back();
+            }
+            time_requests.push_front(TimeStruct{cur_time, {}, 0});
             // XXX：检查这里的时间
-            if (time_requests.size() > predict_time + 1) {
-                timeout_requests.insert(timeout_requests.end(), time_requests.back().requests.begin(),
-                                        time_requests.back().requests.end());
+            if ((int)time_requests.size() > predict_time + 1) {
+                for (const auto& [req_id, size] : time_requests.back().requests) {
+                    timeout_requests.push_back(req_id);
+                }
                 std::swap(time_requests.back(), time_requests.front());
                 time_requests.pop_back();
                 time_requests.front().clear_requests();